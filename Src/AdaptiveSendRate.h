@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include <Antilatency.Api.h>
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+// Send rate state of a node, kept in its TrackingNode
+struct NodeSendRate {
+    // 0 until the node delivered its first pose
+    float rateHz = 0.0f;
+    std::int64_t updatedNs = 0;
+    std::int64_t lastSentNs = 0;
+};
+
+// Picks the rate a node is sent at from its motion. A node moving at the
+// full rate speed or turning at the full rate angular speed is sent on every
+// tick, a still node every max interval, and a node in between at a rate
+// linear in its speed. A node that speeds up gets the higher rate on the
+// same tick; one that slows down decays toward its lower rate with the decay
+// time constant, so a short pause in a motion does not drop the rate. The
+// nodes are still sampled on every tick, only sending is thinned out.
+class AdaptiveSendRate {
+public:
+    AdaptiveSendRate(bool enabled,
+                     std::int32_t tickIntervalMs,
+                     std::int32_t maxIntervalMs,
+                     float fullRateSpeed,
+                     float fullRateAngularSpeed,
+                     std::int32_t decayMs) :
+        _enabled(enabled),
+        _fullRateSpeed(std::max(fullRateSpeed, 1e-3f)),
+        _fullRateAngularSpeed(std::max(fullRateAngularSpeed, 1e-3f)),
+        _decayNs(static_cast<float>(std::max(decayMs, 1)) * 1e6f)
+    {
+        setIntervals(tickIntervalMs, maxIntervalMs);
+    }
+
+    bool isEnabled() const {
+        return _enabled;
+    }
+
+    void setEnabled(bool enabled) {
+        _enabled = enabled;
+    }
+
+    // The tick interval bounds the rate from above, the max interval from below
+    void setIntervals(std::int32_t tickIntervalMs, std::int32_t maxIntervalMs) {
+        _tickIntervalNs = static_cast<std::int64_t>(std::max(tickIntervalMs, 1)) * 1000000;
+        _maxRateHz = 1000.0f / static_cast<float>(std::max(tickIntervalMs, 1));
+        _minRateHz = std::min(1000.0f / static_cast<float>(std::max(maxIntervalMs, 1)), _maxRateHz);
+    }
+
+    // Called with every pose the node delivers, returns the new rate
+    float update(NodeSendRate &rate, const Antilatency::Alt::Tracking::State &state, std::int64_t nowNs) const {
+        const auto &velocity = state.velocity;
+        const auto &angularVelocity = state.localAngularVelocity;
+        float speed = std::sqrt(velocity.x * velocity.x + velocity.y * velocity.y + velocity.z * velocity.z);
+        float angularSpeed = std::sqrt(angularVelocity.x * angularVelocity.x
+                                       + angularVelocity.y * angularVelocity.y
+                                       + angularVelocity.z * angularVelocity.z);
+        float motion = std::max(speed / _fullRateSpeed, angularSpeed / _fullRateAngularSpeed);
+        if (false == std::isfinite(motion)) {
+            motion = 1.0f;
+        }
+        float target = _minRateHz + std::min(motion, 1.0f) * (_maxRateHz - _minRateHz);
+
+        if (target >= rate.rateHz || 0 == rate.updatedNs) {
+            rate.rateHz = target;
+        } else {
+            float elapsed = static_cast<float>(std::max<std::int64_t>(nowNs - rate.updatedNs, 0));
+            rate.rateHz = target + (rate.rateHz - target) * std::exp(-elapsed / _decayNs);
+        }
+        rate.rateHz = std::clamp(rate.rateHz, _minRateHz, _maxRateHz);
+        rate.updatedNs = nowNs;
+        return rate.rateHz;
+    }
+
+    // Ticks are a tick interval apart, so a node is due up to half a tick
+    // before its interval is over
+    bool isDue(const NodeSendRate &rate, std::int64_t nowNs) const {
+        if (false == _enabled || 0.0f == rate.rateHz) {
+            return true;
+        }
+        float intervalNs = 1e9f / rate.rateHz;
+        return static_cast<float>(nowNs - rate.lastSentNs + _tickIntervalNs / 2) >= intervalNs;
+    }
+
+    void onSent(NodeSendRate &rate, std::int64_t nowNs) const {
+        rate.lastSentNs = nowNs;
+    }
+
+private:
+    bool _enabled;
+    const float _fullRateSpeed;
+    const float _fullRateAngularSpeed;
+    const float _decayNs;
+    std::int64_t _tickIntervalNs = 0;
+    float _maxRateHz = 0.0f;
+    float _minRateHz = 0.0f;
+};
+
+}
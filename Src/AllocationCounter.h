@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+
+#ifdef ANTILATENCY_COUNT_ALLOCATIONS
+#   include <cstdlib>
+#   include <new>
+#endif
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+// Counts heap allocations made by the calling thread. Only active in builds
+// configured with -DANTILATENCY_COUNT_ALLOCATIONS=ON, which replace the global
+// operator new; otherwise every call is a no-op returning zero.
+class AllocationCounter {
+public:
+    static std::uint64_t get() {
+        return _count;
+    }
+
+    static void increment() {
+        _count++;
+    }
+
+    static constexpr bool enabled() {
+#ifdef ANTILATENCY_COUNT_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+private:
+    static inline thread_local std::uint64_t _count = 0;
+};
+
+}
+
+#ifdef ANTILATENCY_COUNT_ALLOCATIONS
+namespace Antilatency::IpTrackingDemoProvider::Allocation {
+
+// Kept out of line, so GCC does not see malloc and free through the replaced
+// operators and report every new and delete pair as mismatched
+[[gnu::noinline]] inline void *allocate(std::size_t size) {
+    AllocationCounter::increment();
+    if (void *pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] inline void release(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+}
+
+void *operator new(std::size_t size) {
+    return Antilatency::IpTrackingDemoProvider::Allocation::allocate(size);
+}
+
+void *operator new[](std::size_t size) {
+    return Antilatency::IpTrackingDemoProvider::Allocation::allocate(size);
+}
+
+void operator delete(void *pointer) noexcept {
+    Antilatency::IpTrackingDemoProvider::Allocation::release(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+    Antilatency::IpTrackingDemoProvider::Allocation::release(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+    Antilatency::IpTrackingDemoProvider::Allocation::release(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept {
+    Antilatency::IpTrackingDemoProvider::Allocation::release(pointer);
+}
+#endif
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Antilatency.Api.h>
+
+#include "Parameters.h"
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+// Thin interfaces between the provider loop and the outside world. The SDK
+// implementations live in SdkBackend.h and Gpio.h; FakeBackend.h provides
+// in-process fakes, so the loop runs without trackers, a Raspberry Pi or a
+// receiver.
+
+// Commands of the IP Network receiver plus the ones only the provider knows
+enum class CommandType {
+    SetEnvironmentCode,
+    SetSendingRate,
+    SetPredictionHorizon,
+    SetNodeEnabled,
+    SetLogLevel,
+    TelemetrySnapshot,
+    SetAdaptiveRate,
+    GetSendRates
+};
+
+inline std::string commandToString(CommandType type) {
+    switch (type) {
+    case CommandType::SetEnvironmentCode:
+        return Antilatency::enumToString(Antilatency::IpNetwork::CommandKey::SetEnvinromentCode);
+    case CommandType::SetSendingRate:
+        return Antilatency::enumToString(Antilatency::IpNetwork::CommandKey::SetSendingRate);
+    case CommandType::SetPredictionHorizon:
+        return "SetPredictionHorizon";
+    case CommandType::SetNodeEnabled:
+        return "SetNodeEnabled";
+    case CommandType::SetLogLevel:
+        return "SetLogLevel";
+    case CommandType::TelemetrySnapshot:
+        return "TelemetrySnapshot";
+    case CommandType::SetAdaptiveRate:
+        return "SetAdaptiveRate";
+    case CommandType::GetSendRates:
+        return "GetSendRates";
+    }
+    return "Unknown";
+}
+
+struct Command {
+    CommandType type{};
+    std::string value{};
+};
+
+// CLOCK_MONOTONIC times of a packet. The IP Network packets have no room for
+// them, receivers of the compact encoding get them.
+struct PacketTimes {
+    // Sample time of every pose, empty if not known
+    std::vector<std::int64_t> sampleTimesNs{};
+    // Time of the latest GPIO edge, 0 if no pin changed yet
+    std::int64_t gpioEdgeNs = 0;
+};
+
+class TrackingTask {
+public:
+    virtual ~TrackingTask() = default;
+
+    virtual bool isTaskFinished() = 0;
+    virtual Antilatency::Alt::Tracking::State getState(float angularVelocityAvgTime) = 0;
+};
+
+class TrackingBackend {
+public:
+    virtual ~TrackingBackend() = default;
+
+    virtual std::uint32_t getUpdateId() = 0;
+    virtual std::vector<Antilatency::DeviceNetwork::NodeHandle> findSupportedNodes() = 0;
+    virtual Antilatency::DeviceNetwork::NodeStatus nodeGetStatus(Antilatency::DeviceNetwork::NodeHandle node) = 0;
+    virtual std::string nodeGetParentProperty(Antilatency::DeviceNetwork::NodeHandle node, const std::string &key) = 0;
+
+    // Creates the environment ahead of setEnvironment, may be called from
+    // another thread than the tick thread. Returns false if the environment
+    // could not be created, throws if the code is invalid.
+    virtual bool prepareEnvironment(const std::string &environmentCode) = 0;
+
+    // Tasks started afterwards track in the new environment, cheap if the
+    // environment was prepared. Returns false if the environment could not be
+    // created, throws if the code is invalid.
+    virtual bool setEnvironment(const std::string &environmentCode) = 0;
+
+    // Returns nullptr if the task could not be started
+    virtual std::unique_ptr<TrackingTask> startTask(Antilatency::DeviceNetwork::NodeHandle node) = 0;
+};
+
+class NetworkSink {
+public:
+    virtual ~NetworkSink() = default;
+
+    virtual void startCommandListening() = 0;
+    // Replaces the content of commands with the commands received since the last call
+    virtual void getCommands(std::vector<Command> &commands) = 0;
+    virtual void sendStateMessages(const std::vector<Antilatency::IpNetwork::StateMessage> &poses,
+                                   const std::vector<Antilatency::IpNetwork::GpioPinState> &gpioState,
+                                   const std::string &deviceError,
+                                   const PacketTimes &times) = 0;
+
+    virtual Antilatency::IpNetwork::RawString32 getRawTagFromString(const std::string &tag) = 0;
+    virtual std::string getTagFromRawTag(const Antilatency::IpNetwork::RawString32 &rawTag) = 0;
+    // Time of the IP Network library of the provider, microseconds; not the
+    // clock of a receiver
+    virtual std::uint64_t getCurrentTime() = 0;
+    // Off the tick thread: sets up another receiver, which may take a name
+    // lookup; throws if it cannot be set up
+    virtual void prepareReceiver(const std::string &address, const std::string &port) = 0;
+    // Tick side: sends to the receiver prepared last from now on, returns
+    // false if none is prepared
+    virtual bool switchReceiver() = 0;
+};
+
+// GPIO state as a mask indexed by wiringPi pin number
+class GpioSource {
+public:
+    virtual ~GpioSource() = default;
+
+    virtual bool isReady() const = 0;
+    // Tick side: returns true if the state changed since the previous call or
+    // a keyframe is due
+    virtual bool sample(std::int64_t nowNs, std::uint32_t &mask) = 0;
+    virtual std::uint32_t getMask() const = 0;
+    // CLOCK_MONOTONIC time of the last edge of a pin, 0 if it never changed
+    virtual std::int64_t getEdgeTimestamp(std::uint8_t pin) const = 0;
+    // Time of the latest edge of any pin
+    virtual std::int64_t getLastEdgeTimestamp() const = 0;
+    // Becomes readable when the state changes between ticks, -1 if it never does
+    virtual int getEventFd() const = 0;
+    // Tick side: sets the mode and value of the listed pins, returns false if
+    // GPIO is not set up
+    virtual bool configure(const std::vector<GpioPin> &pins) = 0;
+
+    static void toPinStates(std::uint32_t mask, std::vector<Antilatency::IpNetwork::GpioPinState> &pinStates) {
+        pinStates.clear();
+        for (auto pin : wiringPiPins) {
+            Antilatency::IpNetwork::GpioPinState pinState;
+            pinState.number = pin;
+            pinState.value = 0 != (mask & (std::uint32_t(1) << pin)) ? 1 : 0;
+            pinStates.push_back(pinState);
+        }
+    }
+};
+
+}
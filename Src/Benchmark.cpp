@@ -0,0 +1,682 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cxxopts.hpp>
+
+#include <Antilatency.Api.h>
+
+#include "AllocationCounter.h"
+#include "Backend.h"
+#include "ClockSync.h"
+#include "CompactUdpSink.h"
+#include "CompactWire.h"
+#include "FakeBackend.h"
+#include "Parameters.h"
+#include "PoseSmoother.h"
+#include "ProviderEngine.h"
+#include "SamplingPool.h"
+#include "SharedPosePublisher.h"
+#include "SharedPoses.h"
+#include "StateSender.h"
+#include "Telemetry.h"
+#include "TickScheduler.h"
+
+using namespace Antilatency::IpTrackingDemoProvider;
+
+// Runs the provider loop against fake trackers, GPIO and receiver, so it can
+// be measured on any Linux machine. Exits with 1 when a check fails, which
+// makes the CTest tests in CMakeLists.txt out of its modes.
+
+std::int64_t getCpuTimeNs(clockid_t clock) {
+    timespec time{};
+    clock_gettime(clock, &time);
+    return static_cast<std::int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+
+// Reads the shared memory segment in a tight loop and checks every frame: the
+// sequence never goes back, and every pose lies on the circle of the fake
+// trackers with a unit rotation, which a frame torn by a concurrent write
+// would not
+struct SharedPosesStress {
+    LatencyHistogram read{};
+    // From getState of the oldest pose until a reader saw the frame
+    LatencyHistogram age{};
+    std::uint64_t reads = 0;
+    std::uint64_t frames = 0;
+    std::uint64_t failedReads = 0;
+    std::uint64_t badFrames = 0;
+
+    void run(const std::string &name, const std::atomic<bool> &running) {
+        SharedPoses::Reader reader{};
+        if (false == reader.open(name.c_str())) {
+            badFrames++;
+            return;
+        }
+        auto frame = std::make_unique<SharedPoses::Frame>();
+        std::uint64_t lastSequence = 0;
+        while (true == running.load(std::memory_order_relaxed)) {
+            std::int64_t startNs = TickScheduler::now();
+            bool ok = reader.read(*frame);
+            std::int64_t endNs = TickScheduler::now();
+            read.record(endNs - startNs);
+            reads++;
+            if (false == ok) {
+                // Nothing is published before the first tick
+                failedReads += 0 != lastSequence ? 1 : 0;
+                continue;
+            }
+            if (frame->sequence < lastSequence || false == isConsistent(*frame)) {
+                badFrames++;
+            }
+            if (frame->sequence != lastSequence) {
+                // Sampling starts after the tick timestamp is taken
+                std::int64_t sampledNs = endNs;
+                for (std::uint32_t index = 0; index < frame->poseCount; index++) {
+                    sampledNs = std::min(sampledNs, frame->poses[index].sampleTimeNs);
+                }
+                if (0 == frame->poseCount) {
+                    sampledNs = frame->timestampNs;
+                }
+                age.record(endNs - sampledNs);
+                frames++;
+                lastSequence = frame->sequence;
+            }
+        }
+    }
+
+    static bool isConsistent(const SharedPoses::Frame &frame) {
+        for (std::uint32_t index = 0; index < frame.poseCount; index++) {
+            const auto &pose = frame.poses[index];
+            if (0 != pose.error) {
+                continue;
+            }
+            float radius = pose.position[0] * pose.position[0] + pose.position[2] * pose.position[2];
+            float norm = pose.rotation[0] * pose.rotation[0] + pose.rotation[1] * pose.rotation[1]
+                         + pose.rotation[2] * pose.rotation[2] + pose.rotation[3] * pose.rotation[3];
+            if (std::fabs(radius - 1.0f) > 1e-3f || std::fabs(norm - 1.0f) > 1e-3f) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Times PoseSmoother::update() against updateScalar() on the same noisy
+// circling poses for 1 to 64 nodes and checks both give the same poses
+void runSmoothingBenchmark() {
+    constexpr std::uint32_t Ticks = 20000;
+    std::cout << std::fixed << std::setprecision(1);
+    for (std::size_t nodes = 1; nodes <= MaxTrackingNodes; nodes *= 2) {
+        PoseSmoother vectorized{};
+        PoseSmoother scalar{};
+        std::int64_t vectorizedNs = 0;
+        std::int64_t scalarNs = 0;
+        float maxDifference = 0.0f;
+        std::uint32_t noise = 1;
+        for (std::uint32_t tick = 1; tick <= Ticks; tick++) {
+            std::int64_t timestampNs = static_cast<std::int64_t>(tick) * 1000000;
+            for (std::size_t index = 0; index < nodes; index++) {
+                noise = noise * 1664525u + 1013904223u;
+                float jitter = static_cast<float>(noise >> 8) / 16777216.0f * 0.002f - 0.001f;
+                float angle = static_cast<float>(tick) * 0.001f + static_cast<float>(index);
+                Antilatency::Math::floatP3Q pose{};
+                pose.position.x = std::cos(angle) + jitter;
+                pose.position.y = 1.5f - jitter;
+                pose.position.z = std::sin(angle) + jitter;
+                pose.rotation.y = std::sin(angle / 2.0f);
+                pose.rotation.w = std::cos(angle / 2.0f) + jitter;
+                vectorized.setInput(index, pose, timestampNs);
+                scalar.setInput(index, pose, timestampNs);
+            }
+
+            std::int64_t startNs = TickScheduler::now();
+            vectorized.update(nodes);
+            std::int64_t middleNs = TickScheduler::now();
+            scalar.updateScalar(nodes);
+            scalarNs += TickScheduler::now() - middleNs;
+            vectorizedNs += middleNs - startNs;
+
+            for (std::size_t index = 0; index < nodes; index++) {
+                auto a = vectorized.getPose(index);
+                auto b = scalar.getPose(index);
+                maxDifference = std::max({maxDifference,
+                                          std::fabs(a.position.x - b.position.x),
+                                          std::fabs(a.position.z - b.position.z),
+                                          std::fabs(a.rotation.y - b.rotation.y),
+                                          std::fabs(a.rotation.w - b.rotation.w)});
+            }
+        }
+        std::cout << "smoothing " << nodes << " nodes, ns per tick: scalar "
+                  << static_cast<double>(scalarNs) / Ticks << ", vectorized "
+                  << static_cast<double>(vectorizedNs) / Ticks << ", speedup "
+                  << static_cast<double>(scalarNs) / static_cast<double>(std::max<std::int64_t>(vectorizedNs, 1))
+                  << ", max difference " << std::scientific << maxDifference << std::fixed << "\n";
+    }
+}
+
+// Times SamplingPool::sample() of 1 to 64 fake nodes on the tick thread
+// alone against threadCount threads, with every getState call taking
+// stateCostUs; a cost of 0 leaves only the cost of the synchronisation
+void runSamplingBenchmark(std::uint32_t threadCount, std::int32_t stateCostUs) {
+    constexpr std::uint32_t Ticks = 1000;
+    std::cout << std::fixed << std::setprecision(1);
+    for (std::uint32_t nodes = 1; nodes <= MaxTrackingNodes; nodes *= 2) {
+        FakeScript script{};
+        script.getStateCostUs = stateCostUs;
+        FakeTrackingBackend backend(nodes, script);
+        std::vector<TrackingNode> trackingNodes(nodes);
+        for (std::uint32_t index = 0; index < nodes; index++) {
+            trackingNodes[index].node = static_cast<Antilatency::DeviceNetwork::NodeHandle>(index + 1);
+            trackingNodes[index].trackingCotask = backend.startTask(trackingNodes[index].node);
+        }
+
+        std::array<LatencyHistogram, 2> histograms{};
+        std::array<std::uint32_t, 2> threadCounts{1, threadCount};
+        for (std::size_t run = 0; run < threadCounts.size(); run++) {
+            SamplingPool pool(threadCounts[run]);
+            for (std::uint32_t tick = 0; tick < Ticks; tick++) {
+                std::int64_t startNs = TickScheduler::now();
+                pool.sample(trackingNodes, nodes);
+                histograms[run].record(TickScheduler::now() - startNs);
+            }
+        }
+
+        const auto &serial = histograms[0];
+        const auto &pooled = histograms[1];
+        std::cout << "sampling " << nodes << " nodes, us per tick: 1 thread p50 " << serial.getPercentile(0.5) / 1000.0
+                  << ", p99 " << serial.getPercentile(0.99) / 1000.0
+                  << "; " << threadCount << " threads p50 " << pooled.getPercentile(0.5) / 1000.0
+                  << ", p99 " << pooled.getPercentile(0.99) / 1000.0
+                  << "; speedup of the mean "
+                  << static_cast<double>(serial.getMean())
+                         / static_cast<double>(std::max<std::uint64_t>(pooled.getMean(), 1))
+                  << "\n";
+    }
+}
+
+// A receiver on a loopback socket takes a packet from CompactUdpSink and
+// pings it back. The pong must echo the ping and bracket it in the provider
+// clock, which is the clock of this process here, so the offset is within
+// the round trip of 0. Returns false if there is no valid pong in time.
+bool runPingCheck() {
+    int receiver = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addressSize = sizeof(address);
+    if (receiver < 0 || 0 != bind(receiver, reinterpret_cast<const sockaddr *>(&address), sizeof(address))
+            || 0 != getsockname(receiver, reinterpret_cast<sockaddr *>(&address), &addressSize)) {
+        std::cout << "ping: could not open the receiver socket\n";
+        if (receiver >= 0) {
+            close(receiver);
+        }
+        return false;
+    }
+
+    bool passed = false;
+    ClockOffsetEstimator clock{};
+    {
+        LoopbackSink tagSource{};
+        CompactUdpSink sink(tagSource, "127.0.0.1", std::to_string(ntohs(address.sin_port)));
+        sink.sendStateMessages({}, {}, "ping check", {});
+
+        std::array<std::uint8_t, CompactWire::MaxDatagramSize> datagram{};
+        sockaddr_in provider{};
+        socklen_t providerSize = sizeof(provider);
+        pollfd pollFd{receiver, POLLIN, 0};
+        if (poll(&pollFd, 1, 1000) > 0) {
+            recvfrom(receiver, datagram.data(), datagram.size(), 0, reinterpret_cast<sockaddr *>(&provider), &providerSize);
+        }
+
+        std::vector<std::uint8_t> ping{};
+        for (std::uint32_t attempt = 0; attempt < 10 && false == passed; attempt++) {
+            std::int64_t t0 = TickScheduler::now();
+            CompactWire::encodePing(t0, ping);
+            sendto(receiver, ping.data(), ping.size(), 0, reinterpret_cast<const sockaddr *>(&provider), providerSize);
+            if (poll(&pollFd, 1, 500) <= 0) {
+                continue;
+            }
+            auto size = recv(receiver, datagram.data(), datagram.size(), 0);
+            std::int64_t t3 = TickScheduler::now();
+            std::int64_t echoedNs = 0;
+            std::int64_t t1 = 0;
+            std::int64_t t2 = 0;
+            if (size > 0 && true == CompactWire::decodePong(datagram.data(), static_cast<std::size_t>(size), echoedNs, t1, t2)
+                    && echoedNs == t0 && t0 <= t1 && t1 <= t2 && t2 <= t3) {
+                clock.addExchange(t0, t1, t2, t3);
+                passed = std::llabs(clock.getOffsetNs()) <= clock.getRoundTripNs();
+            }
+        }
+    }
+    close(receiver);
+
+    std::cout << "ping over loopback: " << (true == passed ? "answered" : "no valid pong")
+              << ", round trip " << clock.getRoundTripNs() / 1000 << " us\n";
+    return passed;
+}
+
+// Round trip of random packets through the compact encoding. A receiver
+// joins late, after the tag table went out, and only decodes poses from the
+// next table on. Returns false on any mismatch or error past the quantization.
+bool runWireBenchmark() {
+    constexpr std::uint32_t Packets = 2000;
+    // Rounding is off by half a step at most. The largest rotation component,
+    // at least 1/2, is derived from the three others, so its error is up to
+    // three times theirs times 1/sqrt(2) over 1/2.
+    constexpr double RotationHalfStep = 0.70710678 / ((1u << CompactWire::RotationBits) - 1);
+    constexpr double LargestComponentError = 3.0 * 0.70710678 * RotationHalfStep / 0.5;
+    const double maxRotationChord = std::sqrt(3.0 * RotationHalfStep * RotationHalfStep
+                                              + LargestComponentError * LargestComponentError) + 1e-6;
+    const double rotationBound = 4.0 * std::asin(maxRotationChord / 2.0) * 180.0 / 3.14159265358979;
+    bool passed = true;
+
+    std::cout << std::fixed << std::setprecision(1);
+    for (std::size_t nodes = 1; nodes <= MaxTrackingNodes; nodes *= 2) {
+        CompactWire::Encoder encoder{};
+        CompactWire::Decoder decoder{};
+        CompactWire::DecodedPacket decoded{};
+        std::vector<std::string> tags{};
+        for (std::size_t index = 0; index < nodes; index++) {
+            tags.push_back("tracker" + std::to_string(index));
+        }
+
+        float maxPositionError = 0.0f;
+        double maxRotationError = 0.0;
+        std::size_t poseBytes = 0;
+        std::size_t sentPoses = 0;
+        std::size_t datagrams = 0;
+        std::size_t mismatches = 0;
+        std::size_t outOfBound = 0;
+        std::size_t skipped = 0;
+        std::uint32_t noise = 1;
+        auto random = [&noise](float low, float high) {
+            noise = noise * 1664525u + 1013904223u;
+            return low + static_cast<float>(noise >> 8) / 16777216.0f * (high - low);
+        };
+
+        for (std::uint32_t packetIndex = 0; packetIndex < Packets; packetIndex++) {
+            CompactWire::Packet packet{};
+            packet.timeNs = 1000000000000 + static_cast<std::int64_t>(packetIndex) * 10000000;
+            packet.hasGpio = 0 == packetIndex % 10;
+            packet.gpioMask = noise;
+            packet.gpioEdgeNs = packet.timeNs - 4321987;
+            packet.errorMask = 0 == packetIndex % 7 ? 1u << 5 : 0;
+            packet.text = 0 == packetIndex % 13 ? "Environment changed" : "";
+            for (std::size_t index = 0; index < nodes; index++) {
+                CompactWire::Pose pose{};
+                pose.node = encoder.getNode(tags[index]);
+                pose.error = random(0.0f, 1.0f) < 0.05f ? 7 : 0;
+                pose.sampleTimeNs = packet.timeNs - static_cast<std::int64_t>(random(0.0f, 20000000.0f));
+                pose.position = {random(-50.0f, 50.0f), random(0.0f, 3.0f), random(-50.0f, 50.0f)};
+                float norm = 0.0f;
+                for (auto &component : pose.rotation) {
+                    component = random(-1.0f, 1.0f);
+                    norm += component * component;
+                }
+                for (auto &component : pose.rotation) {
+                    component /= std::sqrt(norm);
+                }
+                packet.poses.push_back(pose);
+            }
+
+            encoder.encode(packet);
+            std::size_t next = 0;
+            for (std::size_t datagram = 0; datagram < encoder.getDatagramCount(); datagram++) {
+                std::size_t size = 0;
+                const std::uint8_t *data = encoder.getDatagram(datagram, size);
+                datagrams++;
+                // The receiver starts listening after the first datagram
+                if (0 == packetIndex && 0 == datagram) {
+                    continue;
+                }
+                if (false == decoder.decode(data, size, decoded)) {
+                    mismatches++;
+                    continue;
+                }
+                if (decoded.timeNs != packet.timeNs || decoded.hasGpio != packet.hasGpio
+                        || (true == packet.hasGpio && (decoded.gpioMask != packet.gpioMask
+                                                       || decoded.gpioEdgeNs != packet.gpioEdgeNs))
+                        || decoded.errorMask != packet.errorMask || decoded.text != packet.text) {
+                    mismatches++;
+                }
+                skipped += decoded.skippedPoses;
+                next += decoded.skippedPoses;
+                for (const auto &pose : decoded.poses) {
+                    const auto &original = packet.poses[next++];
+                    // Ages are sent in microseconds
+                    if (pose.tag != tags[original.node] || pose.error != original.error
+                            || std::llabs(pose.sampleTimeNs - original.sampleTimeNs) >= 1000) {
+                        mismatches++;
+                        continue;
+                    }
+                    if (0 != pose.error) {
+                        continue;
+                    }
+                    // q and -q are the same rotation, the angle between two
+                    // is 4 asin(|q1 - q2| / 2) for the closer sign
+                    double difference = 0.0;
+                    double sum = 0.0;
+                    for (std::size_t component = 0; component < 4; component++) {
+                        double a = pose.rotation[component];
+                        double b = original.rotation[component];
+                        difference += (a - b) * (a - b);
+                        sum += (a + b) * (a + b);
+                    }
+                    for (std::size_t axis = 0; axis < 3; axis++) {
+                        float error = std::fabs(pose.position[axis] - original.position[axis]);
+                        maxPositionError = std::max(maxPositionError, error);
+                        // Plus the float rounding of positions tens of metres away
+                        if (error > CompactWire::PositionResolution / 2.0f
+                                    + std::fabs(original.position[axis]) * 4.0f * FLT_EPSILON) {
+                            outOfBound++;
+                        }
+                    }
+                    double rotationError = 4.0 * std::asin(std::min(std::sqrt(std::min(difference, sum)) / 2.0, 1.0))
+                                           * 180.0 / 3.14159265358979;
+                    maxRotationError = std::max(maxRotationError, rotationError);
+                    if (rotationError > rotationBound) {
+                        outOfBound++;
+                    }
+                }
+            }
+            if (next != packet.poses.size() && 0 != packetIndex) {
+                mismatches++;
+            }
+
+            for (const auto &pose : packet.poses) {
+                poseBytes += (0 != pose.error ? 2 : 1 + CompactWire::PoseSize)
+                             + CompactWire::Detail::varintSize(CompactWire::Detail::ageUs(pose.sampleTimeNs, packet.timeNs));
+            }
+            sentPoses += packet.poses.size();
+        }
+
+        std::cout << "wire " << nodes << " nodes, bytes per tracker " << std::setprecision(1)
+                  << static_cast<double>(poseBytes) / static_cast<double>(sentPoses)
+                  << " (StateMessage " << sizeof(Antilatency::IpNetwork::StateMessage)
+                  << "), datagrams per packet " << static_cast<double>(datagrams) / Packets
+                  << ", max error: position " << std::setprecision(3) << maxPositionError * 1000.0f
+                  << " mm, rotation " << maxRotationError
+                  << " deg, poses skipped " << skipped << ", mismatches " << mismatches
+                  << ", errors past the quantization " << outOfBound << "\n";
+        passed = passed && 0 == mismatches && 0 == outOfBound;
+    }
+    return true == runPingCheck() && true == passed;
+}
+
+int main(int argc, char *argv[]) {
+    std::uint32_t trackers = 8;
+    std::int32_t rate = 100;
+    std::int32_t sendInterval = 0;
+    std::int32_t duration = 10;
+    bool faults = false;
+    std::int32_t faultInterval = 3000;
+    bool delta = false;
+    bool adaptiveRate = false;
+    std::uint32_t shmReaders = 0;
+    std::uint32_t samplingThreads = 1;
+    std::int32_t stateCost = 0;
+    bool realtime = false;
+    bool smoothing = false;
+
+    try {
+        cxxopts::Options options("AntilatencyIpTrackingDemoProviderBenchmark",
+                                 "Antilatency tracking provider loop benchmark");
+        options.add_options()
+            ("h,help", "Print usage", cxxopts::value<bool>())
+            ("n,trackers", "A number of fake trackers", cxxopts::value<std::uint32_t>())
+            ("rate", "A number of ticks per second", cxxopts::value<std::int32_t>())
+            ("send-interval", "A number of milliseconds between packets, 0 sends every sample", cxxopts::value<std::int32_t>())
+            ("duration", "A number of seconds to run", cxxopts::value<std::int32_t>())
+            ("faults", "Unplug a tracker and fail tracking tasks now and then", cxxopts::value<bool>())
+            ("fault-interval", "With --faults, a number of milliseconds a tracking task runs before it fails",
+             cxxopts::value<std::int32_t>())
+            ("delta", "Publish poses on change only, three of every four trackers stay still", cxxopts::value<bool>())
+            ("adaptive-rate", "Send trackers at a rate following their motion, three of every four trackers stay still",
+             cxxopts::value<bool>())
+            ("sampling-threads", "A number of threads sampling the trackers, 1 samples serially", cxxopts::value<std::uint32_t>())
+            ("state-cost", "A number of microseconds every getState call of a fake tracker takes", cxxopts::value<std::int32_t>())
+            ("realtime", "Run the tick thread with SCHED_FIFO priority on the last CPU and lock the memory", cxxopts::value<bool>())
+            ("smoothing", "Smooth the poses with the One-Euro filter bank", cxxopts::value<bool>())
+            ("smoothing-bench", "Compare the vectorized and scalar smoothing for 1 to 64 nodes and exit", cxxopts::value<bool>())
+            ("sampling-bench",
+             "Compare sampling 1 to 64 nodes on 1 thread and on --sampling-threads threads, 4 if not given, and exit",
+             cxxopts::value<bool>())
+            ("wire-bench", "Round trip random packets through the compact encoding and exit", cxxopts::value<bool>())
+            ("shm-readers",
+             "Also publish to shared memory and check it from this many reader threads spinning on it",
+             cxxopts::value<std::uint32_t>());
+        auto args = options.parse(argc, argv);
+
+        if (args.count("help") > 0) {
+            std::cout << options.help() << std::endl;
+            return 0;
+        }
+        if (args.count("smoothing-bench") > 0 && true == args["smoothing-bench"].as<bool>()) {
+            runSmoothingBenchmark();
+            return 0;
+        }
+        if (args.count("wire-bench") > 0 && true == args["wire-bench"].as<bool>()) {
+            return true == runWireBenchmark() ? 0 : 1;
+        }
+        if (args.count("sampling-bench") > 0 && true == args["sampling-bench"].as<bool>()) {
+            std::uint32_t threads = args.count("sampling-threads") > 0 ? args["sampling-threads"].as<std::uint32_t>() : 4;
+            std::int32_t cost = args.count("state-cost") > 0 ? args["state-cost"].as<std::int32_t>() : 0;
+            if (threads < 2 || threads > 16 || cost < 0) {
+                throw std::runtime_error("Sampling threads must be 2 to 16 and state cost not negative");
+            }
+            runSamplingBenchmark(threads, cost);
+            return 0;
+        }
+        if (args.count("trackers") > 0) {
+            trackers = args["trackers"].as<std::uint32_t>();
+        }
+        if (args.count("rate") > 0) {
+            rate = args["rate"].as<std::int32_t>();
+        }
+        if (args.count("send-interval") > 0) {
+            sendInterval = args["send-interval"].as<std::int32_t>();
+        }
+        if (args.count("duration") > 0) {
+            duration = args["duration"].as<std::int32_t>();
+        }
+        if (args.count("faults") > 0) {
+            faults = args["faults"].as<bool>();
+        }
+        if (args.count("fault-interval") > 0) {
+            faultInterval = args["fault-interval"].as<std::int32_t>();
+        }
+        if (args.count("delta") > 0) {
+            delta = args["delta"].as<bool>();
+        }
+        if (args.count("adaptive-rate") > 0) {
+            adaptiveRate = args["adaptive-rate"].as<bool>();
+        }
+        if (args.count("sampling-threads") > 0) {
+            samplingThreads = args["sampling-threads"].as<std::uint32_t>();
+        }
+        if (args.count("state-cost") > 0) {
+            stateCost = args["state-cost"].as<std::int32_t>();
+        }
+        if (args.count("realtime") > 0) {
+            realtime = args["realtime"].as<bool>();
+        }
+        if (args.count("smoothing") > 0) {
+            smoothing = args["smoothing"].as<bool>();
+        }
+        if (args.count("shm-readers") > 0) {
+            shmReaders = args["shm-readers"].as<std::uint32_t>();
+        }
+        if (0 == trackers || trackers > MaxTrackingNodes || rate <= 0 || rate > 1000 || duration <= 0
+                || 0 == samplingThreads || samplingThreads > 16 || stateCost < 0 || faultInterval < 1) {
+            throw std::runtime_error("Trackers must be 1 to " + std::to_string(MaxTrackingNodes)
+                                     + ", rate 1 to 1000, duration positive, sampling threads 1 to 16,"
+                                       " fault interval positive");
+        }
+    } catch (const std::exception &ex) {
+        std::cerr << ex.what() << std::endl;
+        return 1;
+    }
+
+    Logger::instance().setLevel(LogLevel::Warning);
+
+    Parameters params{};
+    params.waitTime = 1000 / rate;
+    params.sendInterval = sendInterval;
+    params.delta = delta;
+    params.adaptiveRate = adaptiveRate;
+    params.samplingThreads = samplingThreads;
+    params.realtime = realtime;
+    params.smoothing = smoothing;
+
+    FakeScript script{};
+    if (true == faults) {
+        script.hotplugIntervalMs = 2000;
+        script.failureIntervalMs = faultInterval;
+    }
+    if (true == delta || true == adaptiveRate) {
+        script.movingNodeStride = 4;
+    }
+    script.getStateCostUs = stateCost;
+    FakeTrackingBackend backend(trackers, script);
+    LoopbackSink sink{};
+    FakeGpioBank gpioSource(250, params.gpioKeyframeInterval);
+
+    Telemetry telemetry({}, params.telemetryInterval);
+    StateSender stateSender(sink, params);
+    stateSender.attachGpio(gpioSource);
+    stateSender.attachTelemetry(telemetry);
+    stateSender.start();
+
+    ProviderEngine engine(params, backend, sink, gpioSource, stateSender, telemetry);
+
+    std::string sharedPosesName = "/antilatency-benchmark-" + std::to_string(getpid());
+    SharedPosePublisher sharedPoses{};
+    std::vector<SharedPosesStress> stress(shmReaders);
+    std::vector<std::thread> readers{};
+    std::atomic<bool> readersRunning{true};
+    if (0 != shmReaders) {
+        if (false == sharedPoses.open(sharedPosesName)) {
+            std::cerr << "Could not create shared memory " << sharedPosesName << std::endl;
+            stateSender.stop();
+            return 1;
+        }
+        engine.attachSharedPoses(sharedPoses);
+        for (auto &reader : stress) {
+            readers.emplace_back([&reader, &sharedPosesName, &readersRunning] {
+                reader.run(sharedPosesName, readersRunning);
+            });
+        }
+    }
+
+    std::thread stopper([&engine, duration] {
+        std::this_thread::sleep_for(std::chrono::seconds(duration));
+        engine.stop();
+    });
+
+    std::int64_t startNs = TickScheduler::now();
+    std::int64_t processCpuNs = getCpuTimeNs(CLOCK_PROCESS_CPUTIME_ID);
+    std::int64_t tickCpuNs = getCpuTimeNs(CLOCK_THREAD_CPUTIME_ID);
+    engine.run();
+    tickCpuNs = getCpuTimeNs(CLOCK_THREAD_CPUTIME_ID) - tickCpuNs;
+    stateSender.stop();
+    processCpuNs = getCpuTimeNs(CLOCK_PROCESS_CPUTIME_ID) - processCpuNs;
+    double seconds = static_cast<double>(TickScheduler::now() - startNs) / 1e9;
+    stopper.join();
+    readersRunning = false;
+    for (auto &reader : readers) {
+        reader.join();
+    }
+
+    const auto &tick = telemetry.getHistogram(Stage::Tick);
+    const auto &lateness = telemetry.getHistogram(Stage::Lateness);
+    const auto &send = telemetry.getHistogram(Stage::Send);
+    const auto &tickStatistics = engine.getTickScheduler().getStatistics();
+    const auto &supervisorStatistics = engine.getSupervisor().getStatistics();
+    double nodeSeconds = seconds * trackers;
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "trackers: " << trackers << ", rate: " << rate << " Hz, duration: " << seconds << " s"
+              << (faults ? ", with faults" : "") << (delta ? ", delta" : "")
+              << (adaptiveRate ? ", adaptive rate" : "") << (realtime ? ", realtime" : "")
+              << (smoothing ? ", smoothing" : "")
+              << ", sampling threads: " << samplingThreads << ", state cost: " << stateCost << " us\n"
+              << "throughput: " << static_cast<double>(tickStatistics.ticks) / seconds << " ticks/s, "
+              << static_cast<double>(sink.getPoses()) / seconds << " poses/s, "
+              << static_cast<double>(sink.getSends()) / seconds << " sends/s, "
+              << static_cast<double>(stateSender.getSentPackets()) / seconds << " packets/s\n"
+              << "samples per packet: "
+              << static_cast<double>(stateSender.getPackedSamples())
+                     / static_cast<double>(std::max<std::uint64_t>(stateSender.getSentPackets(), 1))
+              << ", pack us: p50 " << telemetry.getHistogram(Stage::Pack).getPercentile(0.5) / 1000
+              << ", p99 " << telemetry.getHistogram(Stage::Pack).getPercentile(0.99) / 1000 << "\n"
+              << "smoothing us: p50 " << telemetry.getHistogram(Stage::Smoothing).getPercentile(0.5) / 1000.0
+              << ", p99 " << telemetry.getHistogram(Stage::Smoothing).getPercentile(0.99) / 1000.0 << "\n"
+              << "tick us: p50 " << tick.getPercentile(0.5) / 1000
+              << ", p99 " << tick.getPercentile(0.99) / 1000
+              << ", max " << tick.getMax() / 1000 << "\n"
+              << "lateness us: p50 " << lateness.getPercentile(0.5) / 1000
+              << ", p99 " << lateness.getPercentile(0.99) / 1000
+              << ", max " << lateness.getMax() / 1000 << "\n"
+              << "send us: p50 " << send.getPercentile(0.5) / 1000
+              << ", p99 " << send.getPercentile(0.99) / 1000
+              << ", max " << send.getMax() / 1000 << "\n"
+              << engine.getJitterReport() << "\n"
+              << "overruns: " << tickStatistics.overruns
+              << ", dropped batches: " << stateSender.getDropped()
+              << ", send failures: " << stateSender.getSendFailures()
+              << ", restarts: " << supervisorStatistics.restarts
+              << ", suppressed samples: " << engine.getSuppressedSamples() << "\n"
+              << std::setprecision(3)
+              << "cpu per tracker: tick thread " << 100.0 * static_cast<double>(tickCpuNs) / 1e9 / nodeSeconds
+              << " %, process " << 100.0 * static_cast<double>(processCpuNs) / 1e9 / nodeSeconds << " %"
+              << (0 != shmReaders ? " including the spinning readers" : "") << "\n";
+
+    int status = 0;
+    // The run was too short to cover the restart path
+    if (true == faults && 0 == supervisorStatistics.restarts) {
+        std::cout << "no tracking task was restarted\n";
+        status = 1;
+    }
+    if (true == AllocationCounter::enabled()) {
+        std::cout << "steady state allocations: " << engine.getSteadyStateAllocations() << "\n";
+        if (0 != engine.getSteadyStateAllocations()) {
+            status = 1;
+        }
+    }
+
+    for (std::size_t index = 0; index < stress.size(); index++) {
+        const auto &reader = stress[index];
+        std::cout << std::setprecision(1)
+                  << "shm reader " << index << ": " << reader.reads << " reads, " << reader.frames << " frames of "
+                  << sharedPoses.getSequence() << ", read us: p50 " << reader.read.getPercentile(0.5) / 1000.0
+                  << ", p99 " << reader.read.getPercentile(0.99) / 1000.0
+                  << ", age us: p50 " << reader.age.getPercentile(0.5) / 1000
+                  << ", p99 " << reader.age.getPercentile(0.99) / 1000
+                  << ", failed reads: " << reader.failedReads
+                  << ", bad frames: " << reader.badFrames << "\n";
+        // A torn or out of order frame
+        if (0 != reader.badFrames) {
+            status = 1;
+        }
+    }
+
+    return status;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+// Offset between the provider clock, CLOCK_MONOTONIC as every timestamp the
+// provider publishes, and a remote clock. Only depends on the standard
+// library, so a receiver can include this header alone and run the same
+// estimator on its side of the control socket "ping" exchange or of the
+// ping datagrams of CompactWire.h.
+//
+// An exchange is four timestamps: t0 the request leaves, t1 it arrives at the
+// remote side, t2 the response leaves it and t3 it arrives back:
+//     offset     = ((t1 - t0) + (t2 - t3)) / 2
+//     round trip = (t3 - t0) - (t2 - t1)
+// The offset is off by at most half of the round trip, and exchanges delayed
+// by queueing or scheduling have long round trips. Of the last WindowSize
+// exchanges the one with the shortest round trip is used, so a burst of
+// delayed exchanges does not move the estimate while a drifting clock is
+// still followed.
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+class ClockOffsetEstimator {
+public:
+    static constexpr std::size_t WindowSize = 16;
+
+    // Remote clock minus local clock, nanoseconds
+    void addExchange(std::int64_t t0, std::int64_t t1, std::int64_t t2, std::int64_t t3) {
+        Exchange &exchange = _window[_count % WindowSize];
+        exchange.offsetNs = ((t1 - t0) + (t2 - t3)) / 2;
+        exchange.roundTripNs = (t3 - t0) - (t2 - t1);
+        if (exchange.roundTripNs < 0) {
+            exchange.roundTripNs = 0;
+        }
+        _count++;
+
+        std::size_t best = 0;
+        std::size_t used = _count < WindowSize ? static_cast<std::size_t>(_count) : WindowSize;
+        for (std::size_t index = 1; index < used; index++) {
+            if (_window[index].roundTripNs < _window[best].roundTripNs) {
+                best = index;
+            }
+        }
+
+        _offsetNs.store(_window[best].offsetNs, std::memory_order_relaxed);
+        _roundTripNs.store(_window[best].roundTripNs, std::memory_order_relaxed);
+        _exchanges.store(_count, std::memory_order_release);
+    }
+
+    // The remote side only reports one timestamp, e.g. a clock read through a
+    // library call
+    void addExchange(std::int64_t t0, std::int64_t remoteNs, std::int64_t t3) {
+        addExchange(t0, remoteNs, remoteNs, t3);
+    }
+
+    // The getters are safe from any thread, the offset and its round trip
+    // may come from two consecutive exchanges
+    bool hasEstimate() const {
+        return 0 != _exchanges.load(std::memory_order_acquire);
+    }
+
+    std::int64_t getOffsetNs() const {
+        return _offsetNs.load(std::memory_order_relaxed);
+    }
+
+    // Twice the bound of the offset error
+    std::int64_t getRoundTripNs() const {
+        return _roundTripNs.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t getExchanges() const {
+        return _exchanges.load(std::memory_order_acquire);
+    }
+
+    std::int64_t toRemote(std::int64_t localNs) const {
+        return localNs + getOffsetNs();
+    }
+
+    std::int64_t toLocal(std::int64_t remoteNs) const {
+        return remoteNs - getOffsetNs();
+    }
+
+private:
+    struct Exchange {
+        std::int64_t offsetNs = 0;
+        std::int64_t roundTripNs = 0;
+    };
+
+    // Written by one thread only
+    std::array<Exchange, WindowSize> _window{};
+    std::uint64_t _count = 0;
+
+    std::atomic<std::int64_t> _offsetNs{0};
+    std::atomic<std::int64_t> _roundTripNs{0};
+    std::atomic<std::uint64_t> _exchanges{0};
+};
+
+}
@@ -0,0 +1,413 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Backend.h"
+#include "ClockSync.h"
+#include "Log.h"
+#include "SpscRing.h"
+#include "StateSender.h"
+#include "Telemetry.h"
+#include "TickScheduler.h"
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+enum class CommandSource : std::uint8_t {
+    Receiver,
+    ControlSocket
+};
+
+// A command that passed validation, ready to be applied on a tick boundary
+struct Control {
+    static constexpr std::size_t TextSize = 1024;
+
+    CommandType type = CommandType::SetEnvironmentCode;
+    CommandSource source = CommandSource::Receiver;
+    std::uint32_t id = 0;
+    // Rate, horizon and adaptive rate max interval in milliseconds, 0 or 1
+    // for node enabling, LogLevel
+    std::int32_t number = 0;
+    // Environment code or node tag
+    std::uint16_t length = 0;
+    char text[TextSize];
+
+    std::string getText() const {
+        return std::string(text, length);
+    }
+};
+
+struct ControlAck {
+    CommandType type = CommandType::SetEnvironmentCode;
+    CommandSource source = CommandSource::Receiver;
+    std::uint32_t id = 0;
+    // Answer of a query, e.g. the send rates
+    std::uint16_t length = 0;
+    char text[Control::TextSize];
+};
+
+// Takes commands off the tick thread. Its own thread polls the receiver and
+// the optional --control-socket, validates every command and queues the
+// valid ones for the tick thread, which applies them all on the next tick
+// boundary. Rejected commands are answered right away, applied ones once
+// the tick thread acknowledged them; neither ever goes through the tick.
+// The same thread estimates the offset of the IP Network time of this
+// process, the c_time of the log, by reading it every ClockSyncIntervalMs.
+// It is not the clock of a receiver; receivers of the compact encoding
+// estimate theirs with pings, see CompactWire.h.
+//
+// The receiver can only send SetEnvinromentCode and SetSendingRate and gets
+// answers as status messages. The control socket is a local datagram socket
+// taking one command per datagram and answering the sender with "ok ..." or
+// "error ...":
+//     environment <code>
+//     rate <milliseconds between samples>
+//     horizon <prediction horizon, milliseconds>
+//     node <tag> on|off
+//     log-level debug|info|warning|error|off
+//     adaptive-rate off|<max interval, milliseconds>
+//     send-rates
+//     telemetry
+//     ping <sender clock, ns>
+// ping is answered right away with "pong <sender clock> <received> <sent>",
+// the last two in provider CLOCK_MONOTONIC ns, for ClockOffsetEstimator.
+// e.g. echo "node T1 off" | socat - UNIX-SENDTO:/run/antilatency/control,bind=/tmp/reply
+class CommandChannel {
+public:
+    static constexpr std::int32_t PollIntervalMs = 10;
+    static constexpr std::size_t QueueSize = 32;
+    static constexpr std::int64_t ClockSyncIntervalMs = 100;
+
+    CommandChannel(NetworkSink &sink,
+                   StateSender &stateSender,
+                   const Telemetry &telemetry,
+                   const std::string &socketPath,
+                   bool verbose) :
+        _sink(sink),
+        _stateSender(stateSender),
+        _telemetry(telemetry),
+        _socketPath(socketPath),
+        _verbose(verbose),
+        _controls(QueueSize, OverflowPolicy::DropOldest),
+        _acks(QueueSize, OverflowPolicy::DropOldest)
+    {
+        if (false == _socketPath.empty()) {
+            openSocket();
+        }
+        _thread = std::thread(&CommandChannel::run, this);
+    }
+
+    CommandChannel(const CommandChannel &) = delete;
+    CommandChannel &operator=(const CommandChannel &) = delete;
+
+    ~CommandChannel() {
+        _running = false;
+        if (_thread.joinable()) {
+            _thread.join();
+        }
+        if (_socket >= 0) {
+            close(_socket);
+            unlink(_socketPath.c_str());
+        }
+    }
+
+    // Tick side, returns false when no command is waiting
+    bool pop(Control &control) {
+        return _controls.pop(control);
+    }
+
+    // Tick side, the command was applied; answer is sent along with the ack
+    void acknowledge(const Control &control, const std::string &answer = {}) {
+        _ack.type = control.type;
+        _ack.source = control.source;
+        _ack.id = control.id;
+        _ack.length = static_cast<std::uint16_t>(std::min(answer.size(), Control::TextSize));
+        std::memcpy(_ack.text, answer.data(), _ack.length);
+        _acks.push(_ack);
+    }
+
+    // Maps provider timestamps into the IP Network time
+    const ClockOffsetEstimator &getIpNetworkClock() const {
+        return _ipNetworkClock;
+    }
+
+private:
+    struct Client {
+        std::uint32_t id = 0;
+        sockaddr_un address{};
+        socklen_t addressSize = 0;
+    };
+
+    void openSocket() {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (_socketPath.size() >= sizeof(address.sun_path)) {
+            printError("Control socket path is too long: " + _socketPath, true);
+            return;
+        }
+        std::copy(_socketPath.begin(), _socketPath.end(), address.sun_path);
+
+        _socket = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (_socket < 0) {
+            printError(std::string("Could not create control socket: ") + std::strerror(errno), true);
+            return;
+        }
+        unlink(_socketPath.c_str());
+        if (0 != bind(_socket, reinterpret_cast<const sockaddr *>(&address), sizeof(address))) {
+            printError("Could not bind control socket " + _socketPath + ": " + std::strerror(errno), true);
+            close(_socket);
+            _socket = -1;
+        }
+    }
+
+    void run() {
+        std::vector<Command> commands{};
+        std::array<char, Control::TextSize + 64> datagram{};
+        while (true == _running.load(std::memory_order_relaxed)) {
+            if (_socket >= 0) {
+                pollfd pollFd{_socket, POLLIN, 0};
+                if (poll(&pollFd, 1, PollIntervalMs) > 0 && 0 != (pollFd.revents & POLLIN)) {
+                    Client client{};
+                    client.addressSize = sizeof(client.address);
+                    auto size = recvfrom(_socket, datagram.data(), datagram.size(), MSG_DONTWAIT,
+                                         reinterpret_cast<sockaddr *>(&client.address), &client.addressSize);
+                    std::int64_t receivedNs = TickScheduler::now();
+                    if (size > 0) {
+                        onDatagram(std::string(datagram.data(), static_cast<std::size_t>(size)), client, receivedNs);
+                    }
+                }
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(PollIntervalMs));
+            }
+
+            try {
+                _sink.getCommands(commands);
+                for (const auto &command : commands) {
+                    submit(command.type, command.value, CommandSource::Receiver, nullptr);
+                }
+                syncIpNetworkClock();
+            } catch (const std::exception &ex) {
+                printError(ex.what(), _verbose);
+            }
+
+            while (true == _acks.pop(_receivedAck)) {
+                const ControlAck &ack = _receivedAck;
+                std::string text = commandToString(ack.type);
+                if (0 != ack.length) {
+                    text += " " + std::string(ack.text, ack.length);
+                }
+                if (CommandSource::Receiver == ack.source) {
+                    _stateSender.postMessage(text);
+                } else {
+                    reply(ack.id, "ok " + text);
+                }
+            }
+        }
+    }
+
+    // The IP Network time is read between two local reads, the round trip
+    // being the duration of the call
+    void syncIpNetworkClock() {
+        std::int64_t sendNs = TickScheduler::now();
+        if (sendNs - _lastClockSyncNs < ClockSyncIntervalMs * 1000000) {
+            return;
+        }
+        _lastClockSyncNs = sendNs;
+        std::uint64_t currentTimeUs = _sink.getCurrentTime();
+        std::int64_t receiveNs = TickScheduler::now();
+        if (0 != currentTimeUs) {
+            _ipNetworkClock.addExchange(sendNs, static_cast<std::int64_t>(currentTimeUs) * 1000, receiveNs);
+        }
+    }
+
+    void onDatagram(std::string text, Client &client, std::int64_t receivedNs) {
+        while (false == text.empty() && ('\n' == text.back() || '\r' == text.back())) {
+            text.pop_back();
+        }
+        std::string verb = text.substr(0, text.find(' '));
+        std::string argument = verb.size() < text.size() ? text.substr(verb.size() + 1) : std::string{};
+
+        client.id = ++_lastClientId;
+        if ("ping" == verb) {
+            std::int64_t senderNs = 0;
+            auto result = std::from_chars(argument.data(), argument.data() + argument.size(), senderNs);
+            remember(client);
+            if (std::errc{} != result.ec || argument.data() + argument.size() != result.ptr) {
+                reply(client.id, "error expected ping <sender clock, ns>: " + argument);
+                return;
+            }
+            std::string pong = "pong " + argument + " " + std::to_string(receivedNs) + " ";
+            reply(client.id, pong + std::to_string(TickScheduler::now()));
+            return;
+        }
+        if ("telemetry" == verb) {
+            remember(client);
+            reply(client.id, "ok " + _telemetry.getSnapshot());
+            return;
+        }
+
+        static const std::array<std::pair<const char *, CommandType>, 7> verbs{{
+            {"environment", CommandType::SetEnvironmentCode},
+            {"rate", CommandType::SetSendingRate},
+            {"horizon", CommandType::SetPredictionHorizon},
+            {"node", CommandType::SetNodeEnabled},
+            {"log-level", CommandType::SetLogLevel},
+            {"adaptive-rate", CommandType::SetAdaptiveRate},
+            {"send-rates", CommandType::GetSendRates}
+        }};
+        auto found = std::find_if(verbs.begin(), verbs.end(), [&verb](const auto &entry) {
+            return verb == entry.first;
+        });
+        remember(client);
+        if (found == verbs.end()) {
+            reply(client.id, "error unknown command: " + verb);
+            return;
+        }
+        submit(found->second, argument, CommandSource::ControlSocket, &client);
+    }
+
+    void submit(CommandType type, const std::string &value, CommandSource source, const Client *client) {
+        Control control{};
+        control.type = type;
+        control.source = source;
+        control.id = nullptr != client ? client->id : 0;
+
+        std::string error = validate(value, control);
+        if (false == error.empty()) {
+            printError(commandToString(type) + ": " + error, _verbose);
+            if (CommandSource::Receiver == source) {
+                _stateSender.postMessage(commandToString(type) + ": " + error);
+            } else {
+                reply(control.id, "error " + error);
+            }
+            return;
+        }
+
+        // Applied within a tick, so the queue only fills up if the tick
+        // thread stalls; wait for it rather than lose a command
+        while (_controls.size() >= _controls.capacity() && true == _running.load(std::memory_order_relaxed)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        _controls.push(control);
+    }
+
+    // Fills the control from the command value, returns the reason it is
+    // rejected or an empty string
+    static std::string validate(const std::string &value, Control &control) {
+        switch (control.type) {
+        case CommandType::SetEnvironmentCode:
+            if (true == value.empty() || value.size() > Control::TextSize) {
+                return "environment code must be 1 to " + std::to_string(Control::TextSize) + " characters";
+            }
+            setText(control, value);
+            return {};
+        case CommandType::SetSendingRate:
+            if (false == parseNumber(value, 1, 1000, control.number)) {
+                return "sending rate must be 1 to 1000 milliseconds: " + value;
+            }
+            return {};
+        case CommandType::SetPredictionHorizon:
+            if (false == parseNumber(value, 0, 1000, control.number)) {
+                return "prediction horizon must be 0 to 1000 milliseconds: " + value;
+            }
+            return {};
+        case CommandType::SetNodeEnabled: {
+            auto separator = value.rfind(' ');
+            std::string state = std::string::npos != separator ? value.substr(separator + 1) : std::string{};
+            if (std::string::npos == separator || 0 == separator || ("on" != state && "off" != state)
+                    || separator > Control::TextSize) {
+                return "expected <tag> on|off: " + value;
+            }
+            setText(control, value.substr(0, separator));
+            control.number = "on" == state ? 1 : 0;
+            return {};
+        }
+        case CommandType::SetLogLevel: {
+            LogLevel level = LogLevel::Info;
+            if (false == parseLogLevel(value, level)) {
+                return "could not parse log level: " + value;
+            }
+            control.number = static_cast<std::int32_t>(level);
+            return {};
+        }
+        case CommandType::SetAdaptiveRate:
+            if ("off" == value) {
+                control.number = 0;
+                return {};
+            }
+            if (false == parseNumber(value, 1, 10000, control.number)) {
+                return "expected off or a max interval of 1 to 10000 milliseconds: " + value;
+            }
+            return {};
+        case CommandType::GetSendRates:
+            return {};
+        case CommandType::TelemetrySnapshot:
+            break;
+        }
+        return "not a tick command";
+    }
+
+    static bool parseNumber(const std::string &text, std::int32_t min, std::int32_t max, std::int32_t &number) {
+        auto result = std::from_chars(text.data(), text.data() + text.size(), number);
+        return std::errc{} == result.ec && text.data() + text.size() == result.ptr && number >= min && number <= max;
+    }
+
+    static void setText(Control &control, const std::string &text) {
+        control.length = static_cast<std::uint16_t>(std::min(text.size(), Control::TextSize));
+        std::memcpy(control.text, text.data(), control.length);
+    }
+
+    void remember(const Client &client) {
+        _clients[client.id % _clients.size()] = client;
+    }
+
+    void reply(std::uint32_t id, const std::string &text) {
+        const Client &client = _clients[id % _clients.size()];
+        if (client.id != id || 0 == client.addressSize || _socket < 0) {
+            return;
+        }
+        sendto(_socket, text.data(), text.size(), MSG_DONTWAIT | MSG_NOSIGNAL,
+               reinterpret_cast<const sockaddr *>(&client.address), client.addressSize);
+    }
+
+    NetworkSink &_sink;
+    StateSender &_stateSender;
+    const Telemetry &_telemetry;
+    const std::string _socketPath;
+    const bool _verbose;
+
+    SpscRing<Control> _controls;
+    SpscRing<ControlAck> _acks;
+    // Written by the tick thread
+    ControlAck _ack{};
+    // Read by the channel thread
+    ControlAck _receivedAck{};
+
+    int _socket = -1;
+    std::uint32_t _lastClientId = 0;
+    // Clients waiting for an answer, a slow one is overwritten after this many newer ones
+    std::array<Client, 64> _clients{};
+
+    ClockOffsetEstimator _ipNetworkClock{};
+    std::int64_t _lastClockSyncNs = 0;
+
+    std::atomic<bool> _running{true};
+    std::thread _thread{};
+};
+
+}
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <Antilatency.Api.h>
+
+#include "Backend.h"
+#include "CompactWire.h"
+#include "Log.h"
+#include "TickScheduler.h"
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+// Receiver of the compact encoding in CompactWire.h over plain UDP, for
+// receivers on links too slow for the IP Network packets. Commands, tags and
+// the IP Network time come from tagSource, the primary receiver. Pings of the
+// receiver are answered on a thread of the sink, so the pong times are not
+// held up by the sender; a receiver at a broadcast address gets no pongs, as
+// the socket only takes datagrams from the address it sends to.
+class CompactUdpSink : public NetworkSink {
+public:
+    static constexpr std::int32_t PollIntervalMs = 100;
+
+    CompactUdpSink(NetworkSink &tagSource, const std::string &address, const std::string &port) :
+        _tagSource(tagSource)
+    {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo *addresses = nullptr;
+        int result = getaddrinfo(address.c_str(), port.c_str(), &hints, &addresses);
+        if (0 != result) {
+            throw std::runtime_error("Could not resolve compact receiver " + address + ": " + gai_strerror(result));
+        }
+
+        std::string error{};
+        for (auto *candidate = addresses; nullptr != candidate && _socket < 0; candidate = candidate->ai_next) {
+            _socket = socket(candidate->ai_family, candidate->ai_socktype | SOCK_CLOEXEC, candidate->ai_protocol);
+            if (_socket < 0) {
+                error = std::strerror(errno);
+                continue;
+            }
+            // The address may be a broadcast one, like the default receiver
+            int broadcast = 1;
+            setsockopt(_socket, SOL_SOCKET, SO_BROADCAST, &broadcast, sizeof(broadcast));
+            if (0 != connect(_socket, candidate->ai_addr, candidate->ai_addrlen)) {
+                error = std::strerror(errno);
+                close(_socket);
+                _socket = -1;
+            }
+        }
+        freeaddrinfo(addresses);
+        if (_socket < 0) {
+            throw std::runtime_error("Could not open compact receiver " + address + ":" + port + ": " + error);
+        }
+
+        _packet.poses.reserve(MaxPackedPoses);
+        _pong.reserve(CompactWire::PongSize);
+        _thread = std::thread(&CompactUdpSink::answerPings, this);
+    }
+
+    ~CompactUdpSink() override {
+        _running = false;
+        if (_thread.joinable()) {
+            _thread.join();
+        }
+        if (_socket >= 0) {
+            close(_socket);
+        }
+    }
+
+    CompactUdpSink(const CompactUdpSink &) = delete;
+    CompactUdpSink &operator=(const CompactUdpSink &) = delete;
+
+    void startCommandListening() override {}
+
+    void getCommands(std::vector<Command> &commands) override {
+        commands.clear();
+    }
+
+    void sendStateMessages(const std::vector<Antilatency::IpNetwork::StateMessage> &poses,
+                           const std::vector<Antilatency::IpNetwork::GpioPinState> &gpioState,
+                           const std::string &deviceError,
+                           const PacketTimes &times) override {
+        _packet.timeNs = TickScheduler::now();
+        _packet.hasGpio = false == gpioState.empty();
+        _packet.gpioEdgeNs = times.gpioEdgeNs;
+        _packet.gpioMask = 0;
+        for (const auto &pin : gpioState) {
+            if (0 != pin.value && pin.number < 32) {
+                _packet.gpioMask |= 1u << pin.number;
+            }
+        }
+        setDeviceError(deviceError);
+
+        _packet.poses.clear();
+        for (std::size_t index = 0; index < poses.size(); index++) {
+            const auto &message = poses[index];
+            CompactWire::Pose pose{};
+            pose.node = getNode(message.rawTag);
+            // Poses of unknown time count as sampled when sent
+            pose.sampleTimeNs = index < times.sampleTimesNs.size() ? times.sampleTimesNs[index] : _packet.timeNs;
+            pose.error = static_cast<std::uint32_t>(message.trackerError);
+            pose.position = {message.positionX, message.positionY, message.positionZ};
+            pose.rotation = {message.rotationX, message.rotationY, message.rotationZ, message.rotationW};
+            _packet.poses.push_back(pose);
+        }
+
+        _encoder.encode(_packet);
+        for (std::size_t index = 0; index < _encoder.getDatagramCount(); index++) {
+            std::size_t size = 0;
+            const std::uint8_t *datagram = _encoder.getDatagram(index, size);
+            if (send(_socket, datagram, size, MSG_DONTWAIT) < 0) {
+                throw std::runtime_error(std::string("Compact send failed: ") + std::strerror(errno));
+            }
+        }
+    }
+
+    Antilatency::IpNetwork::RawString32 getRawTagFromString(const std::string &tag) override {
+        return _tagSource.getRawTagFromString(tag);
+    }
+
+    std::string getTagFromRawTag(const Antilatency::IpNetwork::RawString32 &rawTag) override {
+        return _tagSource.getTagFromRawTag(rawTag);
+    }
+
+    std::uint64_t getCurrentTime() override {
+        return _tagSource.getCurrentTime();
+    }
+
+    // Compact receivers are set at startup only
+    void prepareReceiver(const std::string &, const std::string &) override {
+        throw std::runtime_error("Compact receivers are only set at startup");
+    }
+
+    bool switchReceiver() override {
+        return false;
+    }
+
+private:
+    void answerPings() {
+        std::array<std::uint8_t, CompactWire::MaxDatagramSize> datagram{};
+        pollfd pollFd{_socket, POLLIN, 0};
+        while (true == _running.load(std::memory_order_relaxed)) {
+            if (poll(&pollFd, 1, PollIntervalMs) <= 0 || 0 == (pollFd.revents & POLLIN)) {
+                continue;
+            }
+            // An error, like the port of the receiver not being open yet,
+            // only means there is nothing to answer
+            auto size = recv(_socket, datagram.data(), datagram.size(), MSG_DONTWAIT);
+            std::int64_t receivedNs = TickScheduler::now();
+            std::int64_t senderNs = 0;
+            if (size <= 0 || false == CompactWire::decodePing(datagram.data(), static_cast<std::size_t>(size), senderNs)) {
+                continue;
+            }
+            CompactWire::encodePong(senderNs, receivedNs, TickScheduler::now(), _pong);
+            ssize_t sent = send(_socket, _pong.data(), _pong.size(), MSG_DONTWAIT);
+            (void)sent;
+        }
+    }
+
+    struct Node {
+        Antilatency::IpNetwork::RawString32 rawTag{};
+        std::uint32_t index = 0;
+    };
+
+    // Tags are looked up once. The cache holds the tag table of the encoder,
+    // which starts over with index 0 when it is full.
+    std::uint32_t getNode(const Antilatency::IpNetwork::RawString32 &rawTag) {
+        for (const auto &node : _nodes) {
+            if (0 == std::memcmp(&node.rawTag, &rawTag, sizeof(rawTag))) {
+                return node.index;
+            }
+        }
+        std::uint32_t index = _encoder.getNode(_tagSource.getTagFromRawTag(rawTag));
+        if (index != _nodes.size()) {
+            _nodes.clear();
+        }
+        _nodes.push_back(Node{rawTag, index});
+        return index;
+    }
+
+    // The device error is a list of known errors sent as a bit mask, any
+    // other status message is sent as text
+    void setDeviceError(const std::string &deviceError) {
+        if (deviceError == _lastDeviceError) {
+            return;
+        }
+        _lastDeviceError = deviceError;
+        _packet.errorMask = 0;
+        _packet.text.clear();
+
+        using Antilatency::IpNetwork::ErrorType;
+        std::stringstream ss(deviceError);
+        std::string word{};
+        while (std::getline(ss, word, ' ')) {
+            if (true == word.empty()) {
+                continue;
+            }
+            bool known = false;
+            for (auto errorType : {ErrorType::AdnLibraryLoad,
+                                   ErrorType::AltTrackingLibraryLoad,
+                                   ErrorType::TrakingCotaskConstructFailed,
+                                   ErrorType::AltEnvironmentArbitrary2D,
+                                   ErrorType::TrackingNodeNotFound,
+                                   ErrorType::TrackingTaskRestartMessage,
+                                   ErrorType::GetTrackerStateFailed,
+                                   ErrorType::SetupGpio}) {
+                if (word == errorToString(errorType)) {
+                    _packet.errorMask |= 1u << static_cast<std::uint32_t>(errorType);
+                    known = true;
+                    break;
+                }
+            }
+            if (false == known) {
+                _packet.errorMask = 0;
+                _packet.text = deviceError;
+                return;
+            }
+        }
+    }
+
+    NetworkSink &_tagSource;
+    int _socket = -1;
+    CompactWire::Encoder _encoder{};
+    CompactWire::Packet _packet{};
+    std::vector<Node> _nodes{};
+    std::string _lastDeviceError{};
+    // Used by the ping thread only
+    std::vector<std::uint8_t> _pong{};
+    std::atomic<bool> _running{true};
+    std::thread _thread{};
+};
+
+}
@@ -0,0 +1,526 @@
+#pragma once
+
+// Compact binary encoding of the tracking data sent by --compact-receivers,
+// a quarter of the size of the IP Network packets. Only depends on the
+// standard library, so receivers can include this header alone and use
+// Decoder as the reference implementation.
+//
+// Datagram layout, little endian:
+//   header:     u8 magic 0xA7, u8 version, u8 flags, u8 tag table epoch,
+//               u16 sequence, i64 time the datagram was sent
+//   tag table:  if flags & TagTable: varint count, per tag u8 length, bytes
+//   GPIO:       if flags & Gpio: u32 pin states by wiringPi pin number,
+//               i64 time of the latest edge, 0 if no pin changed yet
+//   errors:     if flags & DeviceErrors: varint mask, bit n set for
+//               Antilatency::IpNetwork::ErrorType n
+//   text:       if flags & Text: varint length, bytes; status messages
+//               that are not a list of known errors
+//   poses:      varint count, per pose:
+//                 varint node << 1 | has error, node indexing the tag table
+//                 varint age, microseconds from the sample to the send time
+//                 with an error: varint Antilatency::IpNetwork::ErrorType
+//                 otherwise:     3 x int24 position in 0.1 mm,
+//                                48 bit smallest three rotation
+// The rotation keeps the three smallest components of the quaternion made
+// to have a positive largest one: 2 bits of the index of the largest, then
+// the three others scaled from [-1/sqrt(2), 1/sqrt(2)] to 15 bits each,
+// from the least significant bit up.
+//
+// Node indices refer to the tag table of the epoch in the header. The table
+// is repeated every TagTableInterval datagrams and whenever it changes, a
+// receiver that missed it skips poses until the next one. Every datagram
+// stands alone; a packet with more poses than fit into MaxDatagramSize is
+// split into several datagrams, only a datagram with a large tag table is
+// longer.
+//
+// Times are provider CLOCK_MONOTONIC nanoseconds. To map them into its own
+// clock a receiver sends ping datagrams to the address the tracking data
+// comes from and feeds the pong answers to the ClockOffsetEstimator of
+// ClockSync.h, with its own clock as the local one:
+//   ping:       u8 magic, u8 version, u8 flags Ping, i64 receiver clock t0
+//   pong:       u8 magic, u8 version, u8 flags Pong, i64 t0,
+//               i64 t1 the ping arrived, i64 t2 the pong left
+// The estimator then gives the provider clock minus the receiver clock and
+// toLocal() maps a sample time into the receiver clock.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Antilatency::IpTrackingDemoProvider::CompactWire {
+
+constexpr std::uint8_t Magic = 0xA7;
+constexpr std::uint8_t Version = 2;
+constexpr std::size_t HeaderSize = 14;
+constexpr std::size_t PingSize = 3 + 8;
+constexpr std::size_t PongSize = 3 + 3 * 8;
+constexpr std::size_t MaxDatagramSize = 1400;
+constexpr std::size_t MaxTagSize = 32;
+constexpr std::size_t MaxTextSize = 255;
+// A larger table starts over with the tags in use
+constexpr std::size_t MaxTags = 256;
+constexpr std::uint32_t TagTableInterval = 100;
+// Meters per position unit, and the int24 range in units
+constexpr float PositionResolution = 0.0001f;
+constexpr std::int32_t PositionLimit = (1 << 23) - 1;
+constexpr std::uint32_t RotationBits = 15;
+constexpr std::size_t PoseSize = 9 + 6;
+
+enum Flags : std::uint8_t {
+    TagTable = 1,
+    Gpio = 2,
+    DeviceErrors = 4,
+    Text = 8,
+    // A clock exchange rather than tracking data, see encodePing()
+    Ping = 16,
+    Pong = 32
+};
+
+struct Pose {
+    std::uint32_t node = 0;
+    // Sent as its age, microseconds up to 2^32 - 1, at the send time
+    std::int64_t sampleTimeNs = 0;
+    // Antilatency::IpNetwork::ErrorType, 0 is none; position and rotation
+    // are not sent with an error
+    std::uint32_t error = 0;
+    std::array<float, 3> position{};
+    // x, y, z, w
+    std::array<float, 4> rotation{0.0f, 0.0f, 0.0f, 1.0f};
+};
+
+struct Packet {
+    // Send time in the header
+    std::int64_t timeNs = 0;
+    bool hasGpio = false;
+    std::uint32_t gpioMask = 0;
+    std::int64_t gpioEdgeNs = 0;
+    std::uint32_t errorMask = 0;
+    std::string text{};
+    std::vector<Pose> poses{};
+};
+
+namespace Detail {
+    constexpr float MaxSmallComponent = 0.70710678f;
+
+    inline void putVarint(std::vector<std::uint8_t> &buffer, std::uint32_t value) {
+        while (value >= 0x80) {
+            buffer.push_back(static_cast<std::uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        buffer.push_back(static_cast<std::uint8_t>(value));
+    }
+
+    inline std::size_t varintSize(std::uint32_t value) {
+        std::size_t size = 1;
+        while (value >= 0x80) {
+            value >>= 7;
+            size++;
+        }
+        return size;
+    }
+
+    // Age of a sample at the send time, a sample from the future is 0 old
+    inline std::uint32_t ageUs(std::int64_t sampleTimeNs, std::int64_t timeNs) {
+        std::int64_t ageUs = (timeNs - sampleTimeNs) / 1000;
+        return static_cast<std::uint32_t>(std::clamp<std::int64_t>(ageUs, 0, UINT32_MAX));
+    }
+
+    inline void putBytes(std::vector<std::uint8_t> &buffer, std::uint64_t value, std::size_t count) {
+        for (std::size_t index = 0; index < count; index++) {
+            buffer.push_back(static_cast<std::uint8_t>(value >> (8 * index)));
+        }
+    }
+
+    inline std::uint32_t quantizePosition(float meters) {
+        float units = std::round(meters / PositionResolution);
+        if (false == std::isfinite(units)) {
+            units = 0.0f;
+        }
+        auto value = static_cast<std::int32_t>(std::clamp(units, -static_cast<float>(PositionLimit),
+                                                          static_cast<float>(PositionLimit)));
+        return static_cast<std::uint32_t>(value) & 0xFFFFFF;
+    }
+
+    inline std::uint64_t packRotation(const std::array<float, 4> &rotation) {
+        std::size_t largest = 0;
+        for (std::size_t index = 1; index < 4; index++) {
+            if (std::fabs(rotation[index]) > std::fabs(rotation[largest])) {
+                largest = index;
+            }
+        }
+        float norm = std::sqrt(rotation[0] * rotation[0] + rotation[1] * rotation[1]
+                               + rotation[2] * rotation[2] + rotation[3] * rotation[3]);
+        if (false == (norm > 0.0f) || false == std::isfinite(norm)) {
+            // Identity
+            return 3;
+        }
+        float scale = (rotation[largest] < 0.0f ? -1.0f : 1.0f) / norm;
+
+        constexpr float Steps = static_cast<float>((1u << RotationBits) - 1);
+        std::uint64_t packed = largest;
+        std::uint32_t shift = 2;
+        for (std::size_t index = 0; index < 4; index++) {
+            if (index == largest) {
+                continue;
+            }
+            float unit = (rotation[index] * scale / MaxSmallComponent + 1.0f) / 2.0f;
+            auto step = static_cast<std::uint64_t>(std::round(std::clamp(unit, 0.0f, 1.0f) * Steps));
+            packed |= step << shift;
+            shift += RotationBits;
+        }
+        return packed;
+    }
+
+    inline std::array<float, 4> unpackRotation(std::uint64_t packed) {
+        constexpr float Steps = static_cast<float>((1u << RotationBits) - 1);
+        std::size_t largest = static_cast<std::size_t>(packed & 3);
+        std::array<float, 4> rotation{};
+        std::uint32_t shift = 2;
+        float sum = 0.0f;
+        for (std::size_t index = 0; index < 4; index++) {
+            if (index == largest) {
+                continue;
+            }
+            auto step = static_cast<float>((packed >> shift) & ((1u << RotationBits) - 1));
+            rotation[index] = (step / Steps * 2.0f - 1.0f) * MaxSmallComponent;
+            sum += rotation[index] * rotation[index];
+            shift += RotationBits;
+        }
+        rotation[largest] = std::sqrt(std::max(1.0f - sum, 0.0f));
+        return rotation;
+    }
+
+    // Reads advance data, a read past end marks the reader failed
+    struct Reader {
+        const std::uint8_t *data;
+        const std::uint8_t *end;
+        bool failed = false;
+
+        std::uint64_t bytes(std::size_t count) {
+            if (static_cast<std::size_t>(end - data) < count) {
+                failed = true;
+                return 0;
+            }
+            std::uint64_t value = 0;
+            for (std::size_t index = 0; index < count; index++) {
+                value |= static_cast<std::uint64_t>(data[index]) << (8 * index);
+            }
+            data += count;
+            return value;
+        }
+
+        std::uint32_t varint() {
+            std::uint32_t value = 0;
+            for (std::uint32_t shift = 0; shift < 35; shift += 7) {
+                if (data == end) {
+                    failed = true;
+                    return 0;
+                }
+                std::uint8_t byte = *data++;
+                value |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+                if (0 == (byte & 0x80)) {
+                    return value;
+                }
+            }
+            failed = true;
+            return 0;
+        }
+
+        std::string text(std::size_t size) {
+            if (static_cast<std::size_t>(end - data) < size) {
+                failed = true;
+                return {};
+            }
+            std::string result(reinterpret_cast<const char *>(data), size);
+            data += size;
+            return result;
+        }
+    };
+}
+
+// Sender side. Keeps the tag table and the sequence; the buffers are reused,
+// so encoding allocates only while they grow.
+class Encoder {
+public:
+    // Index of the tag in the table, added if it is new
+    std::uint32_t getNode(const std::string &tag) {
+        std::string key = tag.substr(0, MaxTagSize);
+        auto found = std::find(_tags.begin(), _tags.end(), key);
+        if (found != _tags.end()) {
+            return static_cast<std::uint32_t>(found - _tags.begin());
+        }
+        if (_tags.size() == MaxTags) {
+            _tags.clear();
+        }
+        _tags.push_back(key);
+        _epoch++;
+        _tableDue = true;
+        return static_cast<std::uint32_t>(_tags.size() - 1);
+    }
+
+    // Node indices handed out before may be gone after a new tag was added
+    // to a full table
+    std::uint8_t getEpoch() const {
+        return _epoch;
+    }
+
+    // Encodes the packet into one datagram or more, see getDatagramCount()
+    void encode(const Packet &packet) {
+        _buffer.clear();
+        _datagramEnds.clear();
+
+        std::size_t next = 0;
+        do {
+            std::size_t start = _buffer.size();
+            std::uint8_t flags = 0;
+            bool withTable = true == _tableDue || 0 == _sequence % TagTableInterval;
+            flags |= true == withTable ? TagTable : 0;
+            flags |= true == packet.hasGpio ? Gpio : 0;
+            flags |= 0 != packet.errorMask ? DeviceErrors : 0;
+            flags |= false == packet.text.empty() ? Text : 0;
+
+            _buffer.push_back(Magic);
+            _buffer.push_back(Version);
+            _buffer.push_back(flags);
+            _buffer.push_back(_epoch);
+            Detail::putBytes(_buffer, _sequence++, 2);
+            Detail::putBytes(_buffer, static_cast<std::uint64_t>(packet.timeNs), 8);
+
+            if (true == withTable) {
+                _tableDue = false;
+                Detail::putVarint(_buffer, static_cast<std::uint32_t>(_tags.size()));
+                for (const auto &tag : _tags) {
+                    _buffer.push_back(static_cast<std::uint8_t>(tag.size()));
+                    _buffer.insert(_buffer.end(), tag.begin(), tag.end());
+                }
+            }
+            if (true == packet.hasGpio) {
+                Detail::putBytes(_buffer, packet.gpioMask, 4);
+                Detail::putBytes(_buffer, static_cast<std::uint64_t>(packet.gpioEdgeNs), 8);
+            }
+            if (0 != packet.errorMask) {
+                Detail::putVarint(_buffer, packet.errorMask);
+            }
+            if (false == packet.text.empty()) {
+                std::size_t textSize = std::min(packet.text.size(), MaxTextSize);
+                Detail::putVarint(_buffer, static_cast<std::uint32_t>(textSize));
+                _buffer.insert(_buffer.end(), packet.text.begin(), packet.text.begin() + textSize);
+            }
+
+            // The count is at most 2 bytes for the poses fitting into a datagram
+            std::size_t room = MaxDatagramSize - std::min(MaxDatagramSize, _buffer.size() - start + 2);
+            std::size_t count = 0;
+            std::size_t size = 0;
+            while (next + count < packet.poses.size()) {
+                std::size_t poseSize = encodedSize(packet.poses[next + count], packet.timeNs);
+                if (size + poseSize > room && count > 0) {
+                    break;
+                }
+                size += poseSize;
+                count++;
+            }
+            Detail::putVarint(_buffer, static_cast<std::uint32_t>(count));
+            for (std::size_t index = next; index < next + count; index++) {
+                encodePose(packet.poses[index], packet.timeNs);
+            }
+            next += count;
+            _datagramEnds.push_back(_buffer.size());
+        } while (next < packet.poses.size());
+    }
+
+    std::size_t getDatagramCount() const {
+        return _datagramEnds.size();
+    }
+
+    const std::uint8_t *getDatagram(std::size_t index, std::size_t &size) const {
+        std::size_t start = 0 == index ? 0 : _datagramEnds[index - 1];
+        size = _datagramEnds[index] - start;
+        return _buffer.data() + start;
+    }
+
+private:
+    static std::size_t encodedSize(const Pose &pose, std::int64_t timeNs) {
+        std::size_t size = Detail::varintSize(pose.node << 1 | (0 != pose.error ? 1 : 0))
+                           + Detail::varintSize(Detail::ageUs(pose.sampleTimeNs, timeNs));
+        return size + (0 != pose.error ? Detail::varintSize(pose.error) : PoseSize);
+    }
+
+    void encodePose(const Pose &pose, std::int64_t timeNs) {
+        Detail::putVarint(_buffer, pose.node << 1 | (0 != pose.error ? 1 : 0));
+        Detail::putVarint(_buffer, Detail::ageUs(pose.sampleTimeNs, timeNs));
+        if (0 != pose.error) {
+            Detail::putVarint(_buffer, pose.error);
+            return;
+        }
+        for (float coordinate : pose.position) {
+            Detail::putBytes(_buffer, Detail::quantizePosition(coordinate), 3);
+        }
+        Detail::putBytes(_buffer, Detail::packRotation(pose.rotation), 6);
+    }
+
+    std::vector<std::string> _tags{};
+    std::uint8_t _epoch = 0;
+    bool _tableDue = true;
+    std::uint16_t _sequence = 0;
+    std::vector<std::uint8_t> _buffer{};
+    std::vector<std::size_t> _datagramEnds{};
+};
+
+struct DecodedPose {
+    std::string tag{};
+    // Microsecond resolution
+    std::int64_t sampleTimeNs = 0;
+    std::uint32_t error = 0;
+    std::array<float, 3> position{};
+    std::array<float, 4> rotation{};
+};
+
+struct DecodedPacket {
+    std::uint16_t sequence = 0;
+    std::int64_t timeNs = 0;
+    bool hasGpio = false;
+    std::uint32_t gpioMask = 0;
+    std::int64_t gpioEdgeNs = 0;
+    std::uint32_t errorMask = 0;
+    std::string text{};
+    std::vector<DecodedPose> poses{};
+    // Poses dropped for want of the tag table of their epoch
+    std::size_t skippedPoses = 0;
+};
+
+// Receiver side, the reference decoder
+class Decoder {
+public:
+    // Returns false for a datagram that is not a complete one of this version,
+    // or is a clock exchange
+    bool decode(const std::uint8_t *data, std::size_t size, DecodedPacket &packet) {
+        Detail::Reader reader{data, data + size};
+        packet = DecodedPacket{};
+        if (Magic != reader.bytes(1) || Version != reader.bytes(1)) {
+            return false;
+        }
+        auto flags = static_cast<std::uint8_t>(reader.bytes(1));
+        if (0 != (flags & (Ping | Pong))) {
+            return false;
+        }
+        auto epoch = static_cast<std::uint8_t>(reader.bytes(1));
+        packet.sequence = static_cast<std::uint16_t>(reader.bytes(2));
+        packet.timeNs = static_cast<std::int64_t>(reader.bytes(8));
+
+        if (0 != (flags & TagTable)) {
+            std::uint32_t count = reader.varint();
+            if (count > MaxTags) {
+                return false;
+            }
+            std::vector<std::string> tags{};
+            for (std::uint32_t index = 0; index < count && false == reader.failed; index++) {
+                tags.push_back(reader.text(static_cast<std::size_t>(reader.bytes(1))));
+            }
+            if (true == reader.failed) {
+                return false;
+            }
+            _tags = std::move(tags);
+            _epoch = epoch;
+            _hasTable = true;
+        }
+        if (0 != (flags & Gpio)) {
+            packet.hasGpio = true;
+            packet.gpioMask = static_cast<std::uint32_t>(reader.bytes(4));
+            packet.gpioEdgeNs = static_cast<std::int64_t>(reader.bytes(8));
+        }
+        if (0 != (flags & DeviceErrors)) {
+            packet.errorMask = reader.varint();
+        }
+        if (0 != (flags & Text)) {
+            std::uint32_t textSize = reader.varint();
+            if (textSize > MaxTextSize) {
+                return false;
+            }
+            packet.text = reader.text(textSize);
+        }
+
+        std::uint32_t count = reader.varint();
+        bool tableValid = true == _hasTable && epoch == _epoch;
+        for (std::uint32_t index = 0; index < count && false == reader.failed; index++) {
+            std::uint32_t header = reader.varint();
+            DecodedPose pose{};
+            pose.sampleTimeNs = packet.timeNs - static_cast<std::int64_t>(reader.varint()) * 1000;
+            if (0 != (header & 1)) {
+                pose.error = reader.varint();
+            } else {
+                for (auto &coordinate : pose.position) {
+                    auto units = static_cast<std::uint32_t>(reader.bytes(3));
+                    // Sign extension of int24
+                    coordinate = static_cast<float>(static_cast<std::int32_t>(units << 8) >> 8) * PositionResolution;
+                }
+                pose.rotation = Detail::unpackRotation(reader.bytes(6));
+            }
+
+            std::uint32_t node = header >> 1;
+            if (false == tableValid || node >= _tags.size()) {
+                packet.skippedPoses++;
+                continue;
+            }
+            pose.tag = _tags[node];
+            packet.poses.push_back(std::move(pose));
+        }
+        return false == reader.failed && reader.data == reader.end;
+    }
+
+private:
+    std::vector<std::string> _tags{};
+    std::uint8_t _epoch = 0;
+    bool _hasTable = false;
+};
+
+// Receiver side: a ping carrying the receiver clock, nanoseconds
+inline void encodePing(std::int64_t senderNs, std::vector<std::uint8_t> &buffer) {
+    buffer.clear();
+    buffer.push_back(Magic);
+    buffer.push_back(Version);
+    buffer.push_back(Ping);
+    Detail::putBytes(buffer, static_cast<std::uint64_t>(senderNs), 8);
+}
+
+// Provider side, returns false for any other datagram
+inline bool decodePing(const std::uint8_t *data, std::size_t size, std::int64_t &senderNs) {
+    Detail::Reader reader{data, data + size};
+    if (Magic != reader.bytes(1) || Version != reader.bytes(1) || Ping != reader.bytes(1)) {
+        return false;
+    }
+    senderNs = static_cast<std::int64_t>(reader.bytes(8));
+    return false == reader.failed && reader.data == reader.end;
+}
+
+// Provider side: the sender clock of the ping, the time it arrived and the
+// time the pong leaves
+inline void encodePong(std::int64_t senderNs, std::int64_t receivedNs, std::int64_t sentNs,
+                       std::vector<std::uint8_t> &buffer) {
+    buffer.clear();
+    buffer.push_back(Magic);
+    buffer.push_back(Version);
+    buffer.push_back(Pong);
+    Detail::putBytes(buffer, static_cast<std::uint64_t>(senderNs), 8);
+    Detail::putBytes(buffer, static_cast<std::uint64_t>(receivedNs), 8);
+    Detail::putBytes(buffer, static_cast<std::uint64_t>(sentNs), 8);
+}
+
+// Receiver side, returns false for any other datagram; t0 to t2 of
+// ClockOffsetEstimator::addExchange(), t3 is the time it arrived
+inline bool decodePong(const std::uint8_t *data, std::size_t size,
+                       std::int64_t &senderNs, std::int64_t &receivedNs, std::int64_t &sentNs) {
+    Detail::Reader reader{data, data + size};
+    if (Magic != reader.bytes(1) || Version != reader.bytes(1) || Pong != reader.bytes(1)) {
+        return false;
+    }
+    senderNs = static_cast<std::int64_t>(reader.bytes(8));
+    receivedNs = static_cast<std::int64_t>(reader.bytes(8));
+    sentNs = static_cast<std::int64_t>(reader.bytes(8));
+    return false == reader.failed && reader.data == reader.end;
+}
+
+}
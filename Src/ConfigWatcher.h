@@ -0,0 +1,328 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "Backend.h"
+#include "Log.h"
+#include "Parameters.h"
+#include "TickScheduler.h"
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+// A configuration file saved while running, parsed and validated
+struct ConfigReload {
+    // Parts of the parameters that can change without a restart
+    enum Change : std::uint32_t {
+        Environment = 1,
+        // Wait time, send interval, prediction horizon and adaptive rate
+        Rates = 2,
+        Identifier = 4,
+        Logging = 8,
+        GpioDefaults = 16,
+        // The primary receiver of --receiver and --port, prepared by the
+        // watcher thread
+        Receiver = 32
+    };
+
+    std::shared_ptr<const Parameters> params{};
+    // Parts that differ from the previous version of the file
+    std::uint32_t changes = 0;
+};
+
+// Watches the --config file. Every saved version is parsed with the original
+// command line into an immutable snapshot on the watcher thread, validated
+// and compared with the previous version; the tick thread only picks up the
+// parts that changed and applies them between two ticks. Comparing with the
+// previous version rather than the running parameters keeps what commands
+// changed since, unless the file changes the same part. Changes of the other
+// parameters are reported as needing a restart and not applied.
+//
+// The directory is watched rather than the file, as editors save by writing
+// a new file and renaming it over the old one.
+//
+// A new primary receiver is set up by the watcher thread, as that may take a
+// name lookup, and the tick thread only switches to it.
+class ConfigWatcher {
+public:
+    static constexpr std::int32_t PollIntervalMs = 100;
+    // Editors may write a file in several steps
+    static constexpr std::int64_t SettleNs = 50 * 1000000;
+
+    ConfigWatcher(int argc, char *argv[], const Parameters &params, NetworkSink &sink) :
+        _sink(sink),
+        _args(argv, argv + argc),
+        _filePath(params.configFile),
+        _verbose(params.verbose),
+        _current(std::make_shared<const Parameters>(params))
+    {
+        auto separator = _filePath.rfind('/');
+        std::string directory = std::string::npos == separator ? std::string(".") : _filePath.substr(0, separator);
+        _fileName = std::string::npos == separator ? _filePath : _filePath.substr(separator + 1);
+        if (true == directory.empty()) {
+            directory = "/";
+        }
+
+        _inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (_inotify < 0 || inotify_add_watch(_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            printError("Could not watch configuration file " + _filePath + ": " + std::strerror(errno), true);
+            return;
+        }
+        _thread = std::thread(&ConfigWatcher::run, this);
+    }
+
+    ConfigWatcher(const ConfigWatcher &) = delete;
+    ConfigWatcher &operator=(const ConfigWatcher &) = delete;
+
+    ~ConfigWatcher() {
+        _running = false;
+        if (_thread.joinable()) {
+            _thread.join();
+        }
+        if (_inotify >= 0) {
+            close(_inotify);
+        }
+    }
+
+    // Tick side, returns false when no reload is waiting
+    bool poll(ConfigReload &reload) {
+        if (false == _pending.load(std::memory_order_acquire)) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        reload = std::move(_reload);
+        _reload = ConfigReload{};
+        _pending.store(false, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Returns the reason the parameters cannot be applied while running or
+    // an empty string
+    static std::string validate(const Parameters &params) {
+        if (params.waitTime < 1) {
+            return "wait time must be at least 1 millisecond";
+        }
+        if (params.sendInterval < 0) {
+            return "send interval must not be negative";
+        }
+        if (params.predictionHorizon < 0 || params.predictionHorizon > 1000) {
+            return "prediction horizon must be 0 to 1000 milliseconds";
+        }
+        if (true == params.environmentCode.empty()) {
+            return "environment code must not be empty";
+        }
+        std::int32_t port = 0;
+        auto result = std::from_chars(params.port.data(), params.port.data() + params.port.size(), port);
+        if (std::errc{} != result.ec || params.port.data() + params.port.size() != result.ptr
+                || port < 1 || port > 65535) {
+            return "could not parse port: " + params.port;
+        }
+        return {};
+    }
+
+    static std::uint32_t getChanges(const Parameters &previous, const Parameters &next) {
+        std::uint32_t changes = 0;
+        if (previous.environmentCode != next.environmentCode) {
+            changes |= ConfigReload::Environment;
+        }
+        if (previous.waitTime != next.waitTime
+                || previous.sendInterval != next.sendInterval
+                || previous.predictionHorizon != next.predictionHorizon
+                || previous.adaptiveRate != next.adaptiveRate
+                || previous.adaptiveRateMaxInterval != next.adaptiveRateMaxInterval) {
+            changes |= ConfigReload::Rates;
+        }
+        if (previous.identifier != next.identifier) {
+            changes |= ConfigReload::Identifier;
+        }
+        if (previous.logLevel != next.logLevel || previous.logRate != next.logRate) {
+            changes |= ConfigReload::Logging;
+        }
+        bool samePins = previous.gpioPinsDefaultState.size() == next.gpioPinsDefaultState.size()
+                        && std::equal(previous.gpioPinsDefaultState.begin(), previous.gpioPinsDefaultState.end(),
+                                      next.gpioPinsDefaultState.begin(),
+                                      [](const GpioPin &a, const GpioPin &b) {
+                                          return a.wiringPiPinNumber == b.wiringPiPinNumber
+                                                 && a.mode == b.mode && a.value == b.value;
+                                      });
+        if (false == samePins) {
+            changes |= ConfigReload::GpioDefaults;
+        }
+        if (previous.receiver != next.receiver || previous.port != next.port) {
+            changes |= ConfigReload::Receiver;
+        }
+        return changes;
+    }
+
+    // Options that changed and are only read at startup
+    static std::string getRestartChanges(const Parameters &previous, const Parameters &next) {
+        auto sameReceivers = [](const std::vector<ReceiverSpec> &a, const std::vector<ReceiverSpec> &b) {
+            return a.size() == b.size()
+                   && std::equal(a.begin(), a.end(), b.begin(), [](const ReceiverSpec &x, const ReceiverSpec &y) {
+                          return x.address == y.address && x.port == y.port
+                                 && x.rateDivider == y.rateDivider && x.tags == y.tags;
+                      });
+        };
+        auto sameSmoothing = [](const SmoothingSpec &a, const SmoothingSpec &b) {
+            return a.tag == b.tag && a.minCutoff == b.minCutoff && a.beta == b.beta
+                   && a.derivativeCutoff == b.derivativeCutoff;
+        };
+        bool sameSmoothingTags = previous.smoothingTags.size() == next.smoothingTags.size()
+                                 && std::equal(previous.smoothingTags.begin(), previous.smoothingTags.end(),
+                                               next.smoothingTags.begin(), sameSmoothing);
+
+        std::string options{};
+        auto check = [&options](bool same, const char *option) {
+            if (false == same) {
+                options += (true == options.empty() ? "" : ", ") + std::string(option);
+            }
+        };
+        check(previous.verbose == next.verbose, "verbose");
+        check(sameReceivers(previous.receivers, next.receivers), "receivers");
+        check(sameReceivers(previous.compactReceivers, next.compactReceivers), "compact-receivers");
+        check(previous.overrunPolicy == next.overrunPolicy, "overrun-policy");
+        check(previous.queueSize == next.queueSize, "queue-size");
+        check(previous.overflowPolicy == next.overflowPolicy, "overflow-policy");
+        check(previous.restartBackoff == next.restartBackoff, "restart-backoff");
+        check(previous.restartBackoffMax == next.restartBackoffMax, "restart-backoff-max");
+        check(previous.samplingThreads == next.samplingThreads, "sampling-threads");
+        check(previous.realtime == next.realtime, "realtime");
+        check(previous.realtimePriority == next.realtimePriority, "realtime-priority");
+        check(previous.realtimeCpu == next.realtimeCpu, "realtime-cpu");
+        check(previous.predictionMaxSpeed == next.predictionMaxSpeed, "prediction-max-speed");
+        check(previous.predictionMaxAngularSpeed == next.predictionMaxAngularSpeed, "prediction-max-angular-speed");
+        check(previous.smoothing == next.smoothing, "smoothing");
+        check(sameSmoothing(previous.smoothingDefault, next.smoothingDefault), "smoothing-params");
+        check(sameSmoothingTags, "smoothing-tags");
+        check(previous.delta == next.delta, "delta");
+        check(previous.deltaPosition == next.deltaPosition, "delta-position");
+        check(previous.deltaRotation == next.deltaRotation, "delta-rotation");
+        check(previous.keyframeInterval == next.keyframeInterval, "keyframe-interval");
+        check(previous.adaptiveRateSpeed == next.adaptiveRateSpeed, "adaptive-rate-speed");
+        check(previous.adaptiveRateAngularSpeed == next.adaptiveRateAngularSpeed, "adaptive-rate-angular-speed");
+        check(previous.adaptiveRateDecay == next.adaptiveRateDecay, "adaptive-rate-decay");
+        check(previous.gpioKeyframeInterval == next.gpioKeyframeInterval, "gpio-keyframe");
+        check(previous.telemetryFile == next.telemetryFile, "telemetry");
+        check(previous.telemetryInterval == next.telemetryInterval, "telemetry-interval");
+        check(previous.recordFile == next.recordFile, "record");
+        check(previous.sharedPoses == next.sharedPoses, "shm");
+        check(previous.readyFile == next.readyFile, "ready-file");
+        check(previous.controlSocket == next.controlSocket, "control-socket");
+        check(previous.environmentCacheSize == next.environmentCacheSize, "environment-cache");
+        return options;
+    }
+
+private:
+    void run() {
+        std::int64_t dueNs = 0;
+        while (true == _running.load(std::memory_order_relaxed)) {
+            pollfd descriptor{_inotify, POLLIN, 0};
+            if (::poll(&descriptor, 1, PollIntervalMs) > 0 && true == readEvents()) {
+                dueNs = TickScheduler::now() + SettleNs;
+            }
+            if (0 != dueNs && TickScheduler::now() >= dueNs) {
+                dueNs = 0;
+                reload();
+            }
+        }
+    }
+
+    // Returns true if an event is about the configuration file
+    bool readEvents() {
+        alignas(inotify_event) char buffer[4096];
+        bool changed = false;
+        while (true) {
+            ssize_t size = read(_inotify, buffer, sizeof(buffer));
+            if (size <= 0) {
+                return changed;
+            }
+            for (char *data = buffer; data < buffer + size;) {
+                const auto *event = reinterpret_cast<const inotify_event *>(data);
+                if (0 != event->len && _fileName == event->name) {
+                    changed = true;
+                }
+                data += sizeof(inotify_event) + event->len;
+            }
+        }
+    }
+
+    void reload() {
+        Parameters next{};
+        try {
+            std::vector<char *> argv{};
+            for (auto &arg : _args) {
+                argv.push_back(arg.data());
+            }
+            argv.push_back(nullptr);
+            next = ParametersParser::getParameters(static_cast<int>(_args.size()), argv.data());
+        } catch (const std::exception &ex) {
+            printError("Configuration reload rejected: " + std::string(ex.what()), true);
+            return;
+        }
+        std::string error = validate(next);
+        if (false == error.empty()) {
+            printError("Configuration reload rejected: " + error, true);
+            return;
+        }
+        if (false == next.hasIdentifier) {
+            next.identifier = _current->identifier;
+        }
+
+        std::string restartOptions = getRestartChanges(*_current, next);
+        if (false == restartOptions.empty()) {
+            printError("Configuration changes need a restart: " + restartOptions, true);
+        }
+        std::uint32_t changes = getChanges(*_current, next);
+        if (0 != (changes & ConfigReload::Receiver)) {
+            try {
+                _sink.prepareReceiver(next.receiver, next.port);
+            } catch (const std::exception &ex) {
+                printError("Could not change receiver: " + std::string(ex.what()), true);
+                changes &= ~ConfigReload::Receiver;
+            }
+        }
+        _current = std::make_shared<const Parameters>(std::move(next));
+        if (0 == changes) {
+            printMessage("Configuration reloaded, nothing to apply", _verbose);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        // Merged with a reload the tick thread did not pick up yet
+        _reload.params = _current;
+        _reload.changes |= changes;
+        _pending.store(true, std::memory_order_release);
+    }
+
+    NetworkSink &_sink;
+    std::vector<std::string> _args;
+    const std::string _filePath;
+    std::string _fileName{};
+    const bool _verbose;
+    int _inotify = -1;
+
+    // Watcher thread only
+    std::shared_ptr<const Parameters> _current;
+
+    std::mutex _mutex{};
+    ConfigReload _reload{};
+    std::atomic<bool> _pending{false};
+
+    std::atomic<bool> _running{true};
+    std::thread _thread{};
+};
+
+}
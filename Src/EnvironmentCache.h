@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "Backend.h"
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+// Parsed environments keyed by their code. Holds at most capacity of them
+// and forgets the least recently used one first. The code of an arena is
+// short and parsing it is what costs, so a list searched linearly is enough.
+// Safe to use from several threads.
+template<typename Environment>
+class EnvironmentCache {
+public:
+    explicit EnvironmentCache(std::size_t capacity) :
+        _capacity(std::max<std::size_t>(capacity, 1))
+    {}
+
+    // Returns false if the code is not cached
+    bool find(const std::string &environmentCode, Environment &environment) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto entry = std::find_if(_entries.begin(), _entries.end(), [&environmentCode](const Entry &entry) {
+            return entry.first == environmentCode;
+        });
+        if (entry == _entries.end()) {
+            return false;
+        }
+        _entries.splice(_entries.begin(), _entries, entry);
+        environment = entry->second;
+        return true;
+    }
+
+    void insert(const std::string &environmentCode, Environment environment) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _entries.remove_if([&environmentCode](const Entry &entry) { return entry.first == environmentCode; });
+        _entries.emplace_front(environmentCode, std::move(environment));
+        while (_entries.size() > _capacity) {
+            _entries.pop_back();
+        }
+    }
+
+private:
+    using Entry = std::pair<std::string, Environment>;
+
+    const std::size_t _capacity;
+    std::mutex _mutex{};
+    std::list<Entry> _entries{};
+};
+
+enum class EnvironmentStatus {
+    Pending,
+    Ready,
+    // The environment could not be created
+    Failed,
+    // The code could not be parsed
+    Invalid
+};
+
+// Prepares environments on its own thread, so parsing a code never stalls
+// the tick thread. The tick thread polls until the requested environment is
+// ready and only then switches to it.
+class EnvironmentLoader {
+public:
+    explicit EnvironmentLoader(TrackingBackend &backend) :
+        _backend(backend),
+        _thread(&EnvironmentLoader::run, this)
+    {}
+
+    EnvironmentLoader(const EnvironmentLoader &) = delete;
+    EnvironmentLoader &operator=(const EnvironmentLoader &) = delete;
+
+    ~EnvironmentLoader() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _running = false;
+        }
+        _condition.notify_one();
+        _thread.join();
+    }
+
+    // Tick side: requests the environment unless it is the one requested
+    // last, then returns how far preparing it got. A Failed or Invalid
+    // status is returned once, the next poll of the code requests it again.
+    EnvironmentStatus poll(const std::string &environmentCode) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (environmentCode != _requestedCode) {
+            request(environmentCode);
+        }
+        EnvironmentStatus status = _status;
+        if (EnvironmentStatus::Failed == status || EnvironmentStatus::Invalid == status) {
+            _requestedCode.clear();
+        }
+        return status;
+    }
+
+    // Message of the last Invalid status
+    std::string getError() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _error;
+    }
+
+private:
+    // Called with the mutex locked
+    void request(const std::string &environmentCode) {
+        _requestedCode = environmentCode;
+        _requestGeneration++;
+        _status = EnvironmentStatus::Pending;
+        _condition.notify_one();
+    }
+
+    // Every request is a generation of its own, so a code requested again
+    // is prepared again even if it is the one prepared last
+    void run() {
+        std::uint64_t preparedGeneration = 0;
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true) {
+            _condition.wait(lock, [this, &preparedGeneration] {
+                return false == _running || preparedGeneration != _requestGeneration;
+            });
+            if (false == _running) {
+                return;
+            }
+
+            preparedGeneration = _requestGeneration;
+            std::string preparedCode = _requestedCode;
+            lock.unlock();
+            EnvironmentStatus status = EnvironmentStatus::Failed;
+            std::string error{};
+            try {
+                status = _backend.prepareEnvironment(preparedCode) ? EnvironmentStatus::Ready
+                                                                   : EnvironmentStatus::Failed;
+            } catch (const std::exception &ex) {
+                status = EnvironmentStatus::Invalid;
+                error = ex.what();
+            }
+            lock.lock();
+
+            // A newer request arrived meanwhile, it is picked up by the next wait
+            if (preparedGeneration == _requestGeneration) {
+                _status = status;
+                _error = error;
+            }
+        }
+    }
+
+    TrackingBackend &_backend;
+    mutable std::mutex _mutex{};
+    std::condition_variable _condition{};
+    std::string _requestedCode{};
+    std::uint64_t _requestGeneration = 0;
+    EnvironmentStatus _status = EnvironmentStatus::Pending;
+    std::string _error{};
+    bool _running = true;
+    std::thread _thread;
+};
+
+}
@@ -0,0 +1,357 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <Antilatency.Api.h>
+
+#include "Backend.h"
+#include "TickScheduler.h"
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+struct FakeScript {
+    // Every interval the next node is unplugged, it is plugged back one
+    // interval later; 0 keeps all nodes plugged
+    std::int32_t hotplugIntervalMs = 0;
+    // Every task finishes after about this time and has to be restarted; 0
+    // keeps the tasks running
+    std::int32_t failureIntervalMs = 0;
+    // Only every this many nodes moves, the others stay put like props
+    // lying on a table; 1 moves all of them
+    std::uint32_t movingNodeStride = 1;
+    // Every getState call busy-waits this long, standing in for the time the
+    // SDK spends extrapolating the tracker state
+    std::int32_t getStateCostUs = 0;
+};
+
+class FakeTrackingBackend;
+
+// Moves around a circle of 1 m radius, one turn in 4 seconds, or stays at
+// the start point if the node is static. Every node starts at its own phase,
+// so poses of different nodes differ.
+class FakeTrackingTask : public TrackingTask {
+public:
+    FakeTrackingTask(const FakeTrackingBackend &backend,
+                     Antilatency::DeviceNetwork::NodeHandle node,
+                     std::int64_t finishAtNs,
+                     bool moving,
+                     std::int32_t getStateCostUs);
+
+    bool isTaskFinished() override;
+
+    Antilatency::Alt::Tracking::State getState(float) override {
+        if (0 != _getStateCostNs) {
+            std::int64_t untilNs = TickScheduler::now() + _getStateCostNs;
+            while (TickScheduler::now() < untilNs) {}
+        }
+
+        constexpr float Pi = 3.14159265f;
+        constexpr float AngularSpeed = 2.0f * Pi / 4.0f;
+
+        float time = true == _moving ? static_cast<float>(TickScheduler::now() % 4000000000) / 1e9f : 0.0f;
+        float angle = AngularSpeed * time + _phase;
+
+        Antilatency::Alt::Tracking::State state{};
+        state.pose.position.x = std::cos(angle);
+        state.pose.position.y = 1.5f + 0.1f * std::sin(2.0f * angle);
+        state.pose.position.z = std::sin(angle);
+        state.pose.rotation.x = 0.0f;
+        state.pose.rotation.y = std::sin(-angle / 2.0f);
+        state.pose.rotation.z = 0.0f;
+        state.pose.rotation.w = std::cos(-angle / 2.0f);
+        if (true == _moving) {
+            state.velocity.x = -AngularSpeed * std::sin(angle);
+            state.velocity.y = 0.2f * AngularSpeed * std::cos(2.0f * angle);
+            state.velocity.z = AngularSpeed * std::cos(angle);
+            state.localAngularVelocity.y = -AngularSpeed;
+        }
+        return state;
+    }
+
+private:
+    const FakeTrackingBackend &_backend;
+    const Antilatency::DeviceNetwork::NodeHandle _node;
+    const std::int64_t _finishAtNs;
+    const bool _moving;
+    const std::int64_t _getStateCostNs;
+    const float _phase;
+};
+
+// Synthetic device network of nodeCount tracking nodes with handles 1 to
+// nodeCount, with hot-plug and task failures following the script
+class FakeTrackingBackend : public TrackingBackend {
+public:
+    FakeTrackingBackend(std::uint32_t nodeCount, FakeScript script) :
+        _nodeCount(std::max<std::uint32_t>(nodeCount, 1)),
+        _script(script),
+        _startNs(TickScheduler::now())
+    {}
+
+    std::uint32_t getUpdateId() override {
+        return static_cast<std::uint32_t>(getEpoch()) + 1;
+    }
+
+    std::vector<Antilatency::DeviceNetwork::NodeHandle> findSupportedNodes() override {
+        std::vector<Antilatency::DeviceNetwork::NodeHandle> nodes{};
+        for (std::uint32_t index = 1; index <= _nodeCount; index++) {
+            auto node = static_cast<Antilatency::DeviceNetwork::NodeHandle>(index);
+            if (false == isUnplugged(node)) {
+                nodes.push_back(node);
+            }
+        }
+        return nodes;
+    }
+
+    Antilatency::DeviceNetwork::NodeStatus nodeGetStatus(Antilatency::DeviceNetwork::NodeHandle node) override {
+        return isUnplugged(node) ? Antilatency::DeviceNetwork::NodeStatus::Invalid
+                                 : Antilatency::DeviceNetwork::NodeStatus::Idle;
+    }
+
+    std::string nodeGetParentProperty(Antilatency::DeviceNetwork::NodeHandle node, const std::string &key) override {
+        if (true == isUnplugged(node)) {
+            throw std::runtime_error("Fake node " + std::to_string(static_cast<std::uint32_t>(node)) + " is unplugged");
+        }
+        if (key == Antilatency::DeviceNetwork::Interop::Constants::HardwareSerialNumberKey) {
+            return "FAKE" + std::to_string(static_cast<std::uint32_t>(node));
+        }
+        return {};
+    }
+
+    bool prepareEnvironment(const std::string &environmentCode) override {
+        return false == environmentCode.empty();
+    }
+
+    bool setEnvironment(const std::string &environmentCode) override {
+        return false == environmentCode.empty();
+    }
+
+    std::unique_ptr<TrackingTask> startTask(Antilatency::DeviceNetwork::NodeHandle node) override {
+        if (true == isUnplugged(node)) {
+            return nullptr;
+        }
+
+        std::int64_t finishAtNs = 0;
+        if (0 != _script.failureIntervalMs) {
+            // Failures of different nodes are spread over the interval
+            std::int64_t intervalNs = static_cast<std::int64_t>(_script.failureIntervalMs) * 1000000;
+            finishAtNs = TickScheduler::now() + intervalNs
+                         + intervalNs * (static_cast<std::uint32_t>(node) % _nodeCount) / _nodeCount;
+        }
+        bool moving = 0 == static_cast<std::uint32_t>(node) % std::max<std::uint32_t>(_script.movingNodeStride, 1);
+        return std::make_unique<FakeTrackingTask>(*this, node, finishAtNs, moving, _script.getStateCostUs);
+    }
+
+    std::uint32_t getNodeCount() const {
+        return _nodeCount;
+    }
+
+    bool isUnplugged(Antilatency::DeviceNetwork::NodeHandle node) const {
+        std::int64_t epoch = getEpoch();
+        if (0 == epoch % 2) {
+            return false;
+        }
+        return static_cast<std::uint32_t>(node) == 1 + static_cast<std::uint32_t>(epoch / 2) % _nodeCount;
+    }
+
+private:
+    std::int64_t getEpoch() const {
+        if (0 == _script.hotplugIntervalMs) {
+            return 0;
+        }
+        return (TickScheduler::now() - _startNs) / (static_cast<std::int64_t>(_script.hotplugIntervalMs) * 1000000);
+    }
+
+    const std::uint32_t _nodeCount;
+    const FakeScript _script;
+    const std::int64_t _startNs;
+};
+
+inline FakeTrackingTask::FakeTrackingTask(const FakeTrackingBackend &backend,
+                                          Antilatency::DeviceNetwork::NodeHandle node,
+                                          std::int64_t finishAtNs,
+                                          bool moving,
+                                          std::int32_t getStateCostUs) :
+    _backend(backend),
+    _node(node),
+    _finishAtNs(finishAtNs),
+    _moving(moving),
+    _getStateCostNs(static_cast<std::int64_t>(getStateCostUs) * 1000),
+    _phase(6.2831853f * static_cast<float>(node) / static_cast<float>(backend.getNodeCount()))
+{}
+
+inline bool FakeTrackingTask::isTaskFinished() {
+    return _backend.isUnplugged(_node) || (0 != _finishAtNs && TickScheduler::now() >= _finishAtNs);
+}
+
+// Receiver stand-in: counts what is sent and hands out queued commands
+class LoopbackSink : public NetworkSink {
+public:
+    LoopbackSink() {
+        _commands.reserve(16);
+    }
+
+    void pushCommand(const Command &command) {
+        std::lock_guard<std::mutex> lock(_commandsMutex);
+        _commands.push_back(command);
+    }
+
+    void startCommandListening() override {}
+
+    void getCommands(std::vector<Command> &commands) override {
+        commands.clear();
+        std::lock_guard<std::mutex> lock(_commandsMutex);
+        commands.swap(_commands);
+    }
+
+    void sendStateMessages(const std::vector<Antilatency::IpNetwork::StateMessage> &poses,
+                           const std::vector<Antilatency::IpNetwork::GpioPinState> &gpioState,
+                           const std::string &deviceError,
+                           const PacketTimes &) override {
+        _sends.fetch_add(1, std::memory_order_relaxed);
+        _poses.fetch_add(poses.size(), std::memory_order_relaxed);
+        if (false == gpioState.empty()) {
+            _gpioSends.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (false == deviceError.empty()) {
+            _errorSends.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    Antilatency::IpNetwork::RawString32 getRawTagFromString(const std::string &tag) override {
+        Antilatency::IpNetwork::RawString32 rawTag{};
+        std::memcpy(&rawTag, tag.data(), std::min(tag.size(), sizeof(rawTag)));
+        return rawTag;
+    }
+
+    std::string getTagFromRawTag(const Antilatency::IpNetwork::RawString32 &rawTag) override {
+        const char *data = reinterpret_cast<const char *>(&rawTag);
+        return std::string(data, strnlen(data, sizeof(rawTag)));
+    }
+
+    std::uint64_t getCurrentTime() override {
+        return static_cast<std::uint64_t>(TickScheduler::now() / 1000);
+    }
+
+    void prepareReceiver(const std::string &, const std::string &) override {
+        _receiverPrepared.store(true, std::memory_order_relaxed);
+    }
+
+    bool switchReceiver() override {
+        if (false == _receiverPrepared.exchange(false, std::memory_order_relaxed)) {
+            return false;
+        }
+        _receiverChanges.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    std::uint64_t getSends() const {
+        return _sends.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t getPoses() const {
+        return _poses.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t getGpioSends() const {
+        return _gpioSends.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t getErrorSends() const {
+        return _errorSends.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t getReceiverChanges() const {
+        return _receiverChanges.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::mutex _commandsMutex{};
+    std::vector<Command> _commands{};
+
+    std::atomic<std::uint64_t> _sends{0};
+    std::atomic<std::uint64_t> _poses{0};
+    std::atomic<std::uint64_t> _gpioSends{0};
+    std::atomic<std::uint64_t> _errorSends{0};
+    std::atomic<std::uint64_t> _receiverChanges{0};
+    std::atomic<bool> _receiverPrepared{false};
+};
+
+// Flips one pin at a time, walking through all pins every toggleIntervalMs
+class FakeGpioBank : public GpioSource {
+public:
+    FakeGpioBank(std::int32_t toggleIntervalMs, std::int32_t keyframeIntervalMs) :
+        _toggleIntervalNs(static_cast<std::int64_t>(std::max(toggleIntervalMs, 1)) * 1000000),
+        _keyframeIntervalNs(static_cast<std::int64_t>(keyframeIntervalMs) * 1000000)
+    {}
+
+    bool isReady() const override {
+        return true;
+    }
+
+    bool sample(std::int64_t nowNs, std::uint32_t &mask) override {
+        std::int64_t step = nowNs / _toggleIntervalNs;
+        std::uint8_t pin = wiringPiPins[static_cast<std::size_t>(step) % wiringPiPins.size()];
+        std::uint32_t previous = _mask.exchange(std::uint32_t(1) << pin, std::memory_order_relaxed);
+        if (previous != (std::uint32_t(1) << pin)) {
+            // The pins flip exactly at the step boundary, whenever it is sampled
+            std::int64_t edgeNs = step * _toggleIntervalNs;
+            for (auto changed : wiringPiPins) {
+                if (0 != ((previous ^ (std::uint32_t(1) << pin)) & (std::uint32_t(1) << changed))) {
+                    _edgeTimestampNs[changed].store(edgeNs, std::memory_order_relaxed);
+                }
+            }
+            _lastEdgeNs.store(edgeNs, std::memory_order_relaxed);
+        }
+
+        mask = getMask();
+        if (mask == _lastSampledMask && nowNs - _lastKeyframeNs < _keyframeIntervalNs) {
+            return false;
+        }
+
+        _lastSampledMask = mask;
+        _lastKeyframeNs = nowNs;
+        return true;
+    }
+
+    std::uint32_t getMask() const override {
+        return _mask.load(std::memory_order_relaxed);
+    }
+
+    std::int64_t getEdgeTimestamp(std::uint8_t pin) const override {
+        return _edgeTimestampNs[pin].load(std::memory_order_relaxed);
+    }
+
+    std::int64_t getLastEdgeTimestamp() const override {
+        return _lastEdgeNs.load(std::memory_order_relaxed);
+    }
+
+    int getEventFd() const override {
+        return -1;
+    }
+
+    // The pins keep walking whatever their mode
+    bool configure(const std::vector<GpioPin> &) override {
+        return true;
+    }
+
+private:
+    const std::int64_t _toggleIntervalNs;
+    const std::int64_t _keyframeIntervalNs;
+    std::atomic<std::uint32_t> _mask{0};
+    std::array<std::atomic<std::int64_t>, 32> _edgeTimestampNs{};
+    std::atomic<std::int64_t> _lastEdgeNs{0};
+    std::int64_t _lastKeyframeNs = 0;
+    std::uint32_t _lastSampledMask = 0;
+};
+
+}
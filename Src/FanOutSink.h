@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Antilatency.Api.h>
+
+#include "Backend.h"
+#include "Log.h"
+#include "Telemetry.h"
+#include "TickScheduler.h"
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+// Sends every packet to several receivers. The packet is built once by the
+// sender and the same buffers are handed to every receiver; only receivers
+// with a node filter get their own copy with the other nodes left out.
+// Commands, tags and time come from the primary receiver, the one given by
+// --receiver and --port. Only the primary receiver can be changed while
+// running; the receivers of --receivers and --compact-receivers are set at
+// startup.
+class FanOutSink : public NetworkSink {
+public:
+    explicit FanOutSink(NetworkSink &primary) :
+        _primary(primary)
+    {
+        _destinations.push_back(Destination{});
+        _destinations.back().name = "primary";
+    }
+
+    // Called at startup only
+    void addDestination(const std::string &name,
+                        std::unique_ptr<NetworkSink> sink,
+                        std::uint32_t rateDivider,
+                        const std::vector<std::string> &tags) {
+        Destination destination{};
+        destination.name = name;
+        destination.owned = std::move(sink);
+        destination.rateDivider = std::max<std::uint32_t>(rateDivider, 1);
+        for (const auto &tag : tags) {
+            destination.tags.push_back(_primary.getRawTagFromString(tag));
+        }
+        destination.poses.reserve(MaxPackedPoses);
+        destination.times.sampleTimesNs.reserve(MaxPackedPoses);
+        _destinations.push_back(std::move(destination));
+    }
+
+    // Called at startup only
+    void attachTelemetry(Telemetry &telemetry) {
+        for (auto &destination : _destinations) {
+            destination.telemetry = telemetry.addDestination(destination.name);
+        }
+    }
+
+    void startCommandListening() override {
+        _primary.startCommandListening();
+    }
+
+    void getCommands(std::vector<Command> &commands) override {
+        _primary.getCommands(commands);
+    }
+
+    // Packets with poses are thinned out by the rate divider of a receiver,
+    // status messages and GPIO changes go to every receiver
+    void sendStateMessages(const std::vector<Antilatency::IpNetwork::StateMessage> &poses,
+                           const std::vector<Antilatency::IpNetwork::GpioPinState> &gpioState,
+                           const std::string &deviceError,
+                           const PacketTimes &times) override {
+        std::exception_ptr primaryFailure{};
+        for (auto &destination : _destinations) {
+            if (false == poses.empty()) {
+                bool due = 0 == destination.packets % destination.rateDivider;
+                destination.packets++;
+                if (false == due) {
+                    continue;
+                }
+            }
+
+            const auto *destinationPoses = &poses;
+            const auto *destinationTimes = &times;
+            if (false == destination.tags.empty()) {
+                destination.poses.clear();
+                destination.times.sampleTimesNs.clear();
+                destination.times.gpioEdgeNs = times.gpioEdgeNs;
+                for (std::size_t index = 0; index < poses.size(); index++) {
+                    if (true == destination.accepts(poses[index].rawTag)) {
+                        destination.poses.push_back(poses[index]);
+                        if (index < times.sampleTimesNs.size()) {
+                            destination.times.sampleTimesNs.push_back(times.sampleTimesNs[index]);
+                        }
+                    }
+                }
+                destinationPoses = &destination.poses;
+                destinationTimes = &destination.times;
+                if (true == destination.poses.empty() && false == poses.empty()
+                        && true == gpioState.empty() && true == deviceError.empty()) {
+                    continue;
+                }
+            }
+
+            std::int64_t startNs = TickScheduler::now();
+            try {
+                auto &sink = nullptr != destination.owned ? *destination.owned : _primary;
+                sink.sendStateMessages(*destinationPoses, gpioState, deviceError, *destinationTimes);
+                if (nullptr != destination.telemetry) {
+                    destination.telemetry->send.record(TickScheduler::now() - startNs);
+                    destination.telemetry->sent.fetch_add(1, std::memory_order_relaxed);
+                }
+            } catch (const std::exception &ex) {
+                if (nullptr != destination.telemetry) {
+                    destination.telemetry->dropped.fetch_add(1, std::memory_order_relaxed);
+                }
+                // The primary receiver failure is reported by the caller
+                if (nullptr == destination.owned) {
+                    primaryFailure = std::current_exception();
+                } else {
+                    Logger::instance().write(LogLevel::Debug, destination.name + ": " + ex.what());
+                }
+            }
+        }
+
+        if (nullptr != primaryFailure) {
+            std::rethrow_exception(primaryFailure);
+        }
+    }
+
+    Antilatency::IpNetwork::RawString32 getRawTagFromString(const std::string &tag) override {
+        return _primary.getRawTagFromString(tag);
+    }
+
+    std::string getTagFromRawTag(const Antilatency::IpNetwork::RawString32 &rawTag) override {
+        return _primary.getTagFromRawTag(rawTag);
+    }
+
+    std::uint64_t getCurrentTime() override {
+        return _primary.getCurrentTime();
+    }
+
+    void prepareReceiver(const std::string &address, const std::string &port) override {
+        _primary.prepareReceiver(address, port);
+    }
+
+    bool switchReceiver() override {
+        return _primary.switchReceiver();
+    }
+
+private:
+    struct Destination {
+        std::string name{};
+        // nullptr for the primary receiver
+        std::unique_ptr<NetworkSink> owned{};
+        std::uint32_t rateDivider = 1;
+        std::uint64_t packets = 0;
+        std::vector<Antilatency::IpNetwork::RawString32> tags{};
+        std::vector<Antilatency::IpNetwork::StateMessage> poses{};
+        PacketTimes times{};
+        DestinationTelemetry *telemetry = nullptr;
+
+        bool accepts(const Antilatency::IpNetwork::RawString32 &rawTag) const {
+            return std::any_of(tags.begin(), tags.end(), [&rawTag](const Antilatency::IpNetwork::RawString32 &tag) {
+                return 0 == std::memcmp(&tag, &rawTag, sizeof(rawTag));
+            });
+        }
+    };
+
+    NetworkSink &_primary;
+    std::vector<Destination> _destinations{};
+};
+
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <wiringPi.h>
+
+#include <Antilatency.Api.h>
+
+#include "Backend.h"
+#include "Parameters.h"
+#include "TickScheduler.h"
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+// Current state of the GPIO pins as a mask indexed by wiringPi pin number.
+// Pins set up as inputs with --gpio are tracked by edge interrupts, so a
+// change is visible as soon as it happens instead of on the next tick. All
+// other pins are read on every tick: attaching an interrupt makes a pin an
+// input, which would take it from UART, I2C, SPI or another process.
+class GpioBank : public GpioSource {
+public:
+    GpioBank() :
+        _event(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    {}
+
+    GpioBank(const GpioBank &) = delete;
+    GpioBank &operator=(const GpioBank &) = delete;
+
+    ~GpioBank() {
+        _instance.store(nullptr, std::memory_order_release);
+        if (_event >= 0) {
+            close(_event);
+        }
+    }
+
+    bool setup(const std::vector<GpioPin> &defaultState, std::int32_t keyframeIntervalMs) {
+        _keyframeIntervalNs = static_cast<std::int64_t>(keyframeIntervalMs) * 1000000;
+
+        // WIRINGPI_CODES is set by main before any thread starts, so a failure
+        // is reported instead of terminating the process
+        if (0 != wiringPiSetup()) {
+            return false;
+        }
+
+        applyPins(defaultState);
+        std::uint32_t inputs = 0;
+        for (auto gpioPin : defaultState) {
+            if (INPUT == gpioPin.mode) {
+                inputs |= bit(gpioPin.wiringPiPinNumber);
+            }
+        }
+
+        static const auto edgeHandlers = makeEdgeHandlers(std::make_index_sequence<wiringPiPins.size()>{});
+
+        _instance.store(this, std::memory_order_release);
+        _polledMask = 0;
+        for (std::size_t index = 0; index < wiringPiPins.size(); index++) {
+            std::uint8_t pin = wiringPiPins[index];
+            if (0 == (inputs & bit(pin)) || wiringPiISR(pin, INT_EDGE_BOTH, edgeHandlers[index]) < 0) {
+                _polledMask |= bit(pin);
+            }
+            update(pin, digitalRead(pin), TickScheduler::now());
+        }
+
+        _ready = true;
+        return true;
+    }
+
+    bool isReady() const override {
+        return _ready;
+    }
+
+    // Also refreshes the polled pins
+    bool sample(std::int64_t nowNs, std::uint32_t &mask) override {
+        if (false == _ready) {
+            return false;
+        }
+
+        for (auto pin : wiringPiPins) {
+            if (0 != (_polledMask & bit(pin))) {
+                update(pin, digitalRead(pin), nowNs);
+            }
+        }
+
+        mask = getMask();
+        if (mask == _lastSampledMask && nowNs - _lastKeyframeNs < _keyframeIntervalNs) {
+            return false;
+        }
+
+        _lastSampledMask = mask;
+        _lastKeyframeNs = nowNs;
+        return true;
+    }
+
+    std::uint32_t getMask() const override {
+        return _mask.load(std::memory_order_acquire);
+    }
+
+    std::int64_t getEdgeTimestamp(std::uint8_t pin) const override {
+        return _edgeTimestampNs[pin].load(std::memory_order_relaxed);
+    }
+
+    std::int64_t getLastEdgeTimestamp() const override {
+        return _lastEdgeNs.load(std::memory_order_acquire);
+    }
+
+    // Becomes readable on every edge of an interrupt driven pin
+    int getEventFd() const override {
+        return _event;
+    }
+
+    // Interrupts are only set up at startup, so the pins are polled from now
+    // on whatever their new mode
+    bool configure(const std::vector<GpioPin> &pins) override {
+        if (false == _ready) {
+            return false;
+        }
+        applyPins(pins);
+        for (auto gpioPin : pins) {
+            _polledMask |= bit(gpioPin.wiringPiPinNumber);
+        }
+        return true;
+    }
+
+private:
+    static void applyPins(const std::vector<GpioPin> &pins) {
+        for (auto gpioPin : pins) {
+            pinMode(gpioPin.wiringPiPinNumber, gpioPin.mode);
+            digitalWrite(gpioPin.wiringPiPinNumber, gpioPin.value);
+        }
+    }
+
+    static constexpr std::uint32_t bit(std::uint8_t pin) {
+        return std::uint32_t(1) << pin;
+    }
+
+    void update(std::uint8_t pin, int value, std::int64_t nowNs) {
+        std::uint32_t previous = value != 0
+                                 ? _mask.fetch_or(bit(pin), std::memory_order_acq_rel)
+                                 : _mask.fetch_and(~bit(pin), std::memory_order_acq_rel);
+        if ((0 != (previous & bit(pin))) != (value != 0)) {
+            _edgeTimestampNs[pin].store(nowNs, std::memory_order_relaxed);
+            _lastEdgeNs.store(nowNs, std::memory_order_release);
+        }
+    }
+
+    void onEdge(std::uint8_t pin) {
+        update(pin, digitalRead(pin), TickScheduler::now());
+        std::uint64_t value = 1;
+        ssize_t written = write(_event, &value, sizeof(value));
+        (void)written;
+    }
+
+    // wiringPiISR takes a plain function, so every pin gets its own trampoline
+    template<std::size_t Index>
+    static void edgeHandler() {
+        GpioBank *instance = _instance.load(std::memory_order_acquire);
+        if (nullptr != instance) {
+            instance->onEdge(wiringPiPins[Index]);
+        }
+    }
+
+    template<std::size_t... Indices>
+    static constexpr std::array<void (*)(), sizeof...(Indices)> makeEdgeHandlers(std::index_sequence<Indices...>) {
+        return {&edgeHandler<Indices>...};
+    }
+
+    // Read by the wiringPi interrupt threads
+    static inline std::atomic<GpioBank *> _instance{nullptr};
+
+    int _event = -1;
+    bool _ready = false;
+    std::uint32_t _polledMask = 0;
+    std::atomic<std::uint32_t> _mask{0};
+    std::array<std::atomic<std::int64_t>, 32> _edgeTimestampNs{};
+    std::atomic<std::int64_t> _lastEdgeNs{0};
+
+    std::int64_t _keyframeIntervalNs = 0;
+    std::int64_t _lastKeyframeNs = 0;
+    std::uint32_t _lastSampledMask = 0;
+};
+
+}
@@ -0,0 +1,449 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <Antilatency.Api.h>
+
+#include "SpscRing.h"
+#include "StateBatch.h"
+#include "TickScheduler.h"
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+enum class LogLevel : std::uint8_t {
+    Debug,
+    Info,
+    Warning,
+    Error,
+    Off
+};
+
+// Reads debug, info, warning, error or off, returns false for anything else
+inline bool parseLogLevel(const std::string &text, LogLevel &level) {
+    static const std::array<std::pair<const char *, LogLevel>, 5> levels{{
+        {"debug", LogLevel::Debug},
+        {"info", LogLevel::Info},
+        {"warning", LogLevel::Warning},
+        {"error", LogLevel::Error},
+        {"off", LogLevel::Off}
+    }};
+    for (const auto &entry : levels) {
+        if (text == entry.first) {
+            level = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+// enumToString builds a new string on every call, hot paths use these copies
+// made once at startup
+const std::string &errorToString(Antilatency::IpNetwork::ErrorType errorType) {
+    using Antilatency::IpNetwork::ErrorType;
+    static const std::map<ErrorType, std::string> strings = [] {
+        std::map<ErrorType, std::string> result{};
+        for (auto errorType : {ErrorType::None,
+                               ErrorType::AdnLibraryLoad,
+                               ErrorType::AltTrackingLibraryLoad,
+                               ErrorType::TrakingCotaskConstructFailed,
+                               ErrorType::AltEnvironmentArbitrary2D,
+                               ErrorType::TrackingNodeNotFound,
+                               ErrorType::TrackingTaskRestartMessage,
+                               ErrorType::GetTrackerStateFailed,
+                               ErrorType::SetupGpio}) {
+            result.emplace(errorType, Antilatency::enumToString(errorType));
+        }
+        return result;
+    }();
+    static const std::string unknown = "Unknown";
+
+    auto found = strings.find(errorType);
+    return found != strings.end() ? found->second : unknown;
+}
+
+struct LogRecord {
+    enum class Kind : std::uint8_t {
+        Text,
+        Tick,
+        Pose
+    };
+
+    static constexpr std::size_t TextSize = 96;
+
+    Kind kind = Kind::Text;
+    LogLevel level = LogLevel::Info;
+    // Long texts are split into several records, all but the last are continued
+    bool continued = false;
+    std::uint8_t length = 0;
+    std::int64_t timestampNs = 0;
+    char text[TextSize];
+
+    // Kind::Tick
+    std::uint64_t currentTime = 0;
+    std::int64_t latenessNs = 0;
+    std::uint32_t gpioMask = 0;
+    bool hasGpio = false;
+    bool trackingNodeNotFound = false;
+    bool setupGpioFailed = false;
+    bool hasClockOffset = false;
+    std::int64_t clockOffsetNs = 0;
+
+    // Kind::Pose
+    Antilatency::IpNetwork::StateMessage pose;
+    std::int64_t sampleTimeNs = 0;
+    float sendRateHz = 0.0f;
+};
+
+// Asynchronous logger. Every thread writes fixed size binary records into its
+// own lock-free ring; a background thread formats them, applies the per
+// message rate limit and writes them out, so logging never blocks the caller
+// on a slow terminal or pipe. Records that do not fit into a ring are dropped
+// and counted.
+class Logger {
+public:
+    static Logger &instance() {
+        static Logger logger{};
+        return logger;
+    }
+
+    Logger(const Logger &) = delete;
+    Logger &operator=(const Logger &) = delete;
+
+    ~Logger() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _running = false;
+        }
+        _wakeUp.notify_one();
+        _thread.join();
+        drain();
+        std::flush(std::cout);
+    }
+
+    void setLevel(LogLevel level) {
+        _level.store(level, std::memory_order_relaxed);
+    }
+
+    LogLevel getLevel() const {
+        return _level.load(std::memory_order_relaxed);
+    }
+
+    bool isEnabled(LogLevel level) const {
+        return level >= getLevel() && LogLevel::Off != level;
+    }
+
+    // Not more than ratePerSecond records of every distinct message, 0 disables the limit
+    void setRateLimit(std::uint32_t ratePerSecond) {
+        _rateLimit.store(ratePerSecond, std::memory_order_relaxed);
+    }
+
+    void setIdentifier(const std::string &identifier) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _identifier = identifier;
+    }
+
+    void setTagFormatter(std::function<std::string(const Antilatency::IpNetwork::RawString32 &)> tagFormatter) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tagFormatter = tagFormatter;
+    }
+
+    void write(LogLevel level, std::string_view message) {
+        if (false == isEnabled(level)) {
+            return;
+        }
+
+        auto &ring = getRing();
+        LogRecord record{};
+        record.kind = LogRecord::Kind::Text;
+        record.level = level;
+        record.timestampNs = TickScheduler::now();
+        do {
+            record.length = static_cast<std::uint8_t>(std::min(message.size(), LogRecord::TextSize));
+            std::memcpy(record.text, message.data(), record.length);
+            message.remove_prefix(record.length);
+            record.continued = false == message.empty();
+            ring.push(record);
+        } while (false == message.empty());
+    }
+
+    void writeTick(const StateBatch &batch, std::uint64_t currentTime) {
+        if (false == isEnabled(LogLevel::Info)) {
+            return;
+        }
+
+        auto &ring = getRing();
+        LogRecord record{};
+        record.kind = LogRecord::Kind::Tick;
+        record.level = LogLevel::Info;
+        record.timestampNs = batch.timestampNs;
+        record.currentTime = currentTime;
+        record.latenessNs = batch.latenessNs;
+        record.gpioMask = batch.gpioMask;
+        record.hasGpio = batch.hasGpio;
+        record.trackingNodeNotFound = batch.trackingNodeNotFound;
+        record.setupGpioFailed = batch.setupGpioFailed;
+        record.hasClockOffset = batch.hasClockOffset;
+        record.clockOffsetNs = batch.clockOffsetNs;
+        ring.push(record);
+
+        record.kind = LogRecord::Kind::Pose;
+        for (std::uint32_t index = 0; index < batch.poseCount; index++) {
+            record.pose = batch.poses[index];
+            record.sampleTimeNs = batch.sampleTimesNs[index];
+            record.sendRateHz = batch.sendRatesHz[index];
+            ring.push(record);
+        }
+    }
+
+    std::uint64_t getDropped() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::uint64_t dropped = 0;
+        for (auto &producer : _producers) {
+            dropped += producer->ring.getDropped();
+        }
+        return dropped;
+    }
+
+    std::uint64_t getSuppressed() const {
+        return _suppressed.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr std::size_t RingSize = 512;
+
+    struct Bucket {
+        double tokens = 0.0;
+        std::int64_t updatedNs = 0;
+    };
+
+    // Ring of a thread, with the state of its record sequences that is kept
+    // by the logger thread between two drains
+    struct Producer {
+        SpscRing<LogRecord> ring{RingSize, OverflowPolicy::DropOldest};
+        // A text split into several records that are not all popped yet
+        std::string text{};
+        // Of the latest Kind::Tick record, for its Kind::Pose records
+        bool tickAllowed = true;
+        bool hasClockOffset = false;
+        std::int64_t clockOffsetNs = 0;
+    };
+
+    Logger() :
+        _thread(&Logger::run, this)
+    {}
+
+    SpscRing<LogRecord> &getRing() {
+        thread_local SpscRing<LogRecord> *ring = nullptr;
+        if (nullptr == ring) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _producers.push_back(std::make_unique<Producer>());
+            ring = &_producers.back()->ring;
+        }
+        return *ring;
+    }
+
+    void run() {
+        std::int64_t reportedAtNs = TickScheduler::now();
+        std::uint64_t reportedLosses = 0;
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true == _running) {
+            _wakeUp.wait_for(lock, std::chrono::milliseconds(10));
+            lock.unlock();
+
+            drain();
+
+            std::int64_t now = TickScheduler::now();
+            if (now - reportedAtNs >= 1000000000) {
+                std::uint64_t losses = getDropped() + getSuppressed();
+                if (losses != reportedLosses) {
+                    std::cerr << "log: " << losses - reportedLosses << " records dropped or rate limited\n";
+                    reportedLosses = losses;
+                }
+                evictIdleBuckets(now);
+                reportedAtNs = now;
+            }
+
+            lock.lock();
+        }
+    }
+
+    void drain() {
+        std::size_t producerCount = 0;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            producerCount = _producers.size();
+        }
+
+        for (std::size_t index = 0; index < producerCount; index++) {
+            Producer *producer = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                producer = _producers[index].get();
+            }
+
+            while (producer->ring.pop(_record)) {
+                format(*producer, _record);
+            }
+        }
+
+        std::flush(std::cout);
+        std::flush(std::cerr);
+    }
+
+    // A producer may have pushed only a part of a long text when its ring is
+    // drained, the rest is appended to its own text on a later drain
+    void format(Producer &producer, const LogRecord &record) {
+        if (LogRecord::Kind::Text == record.kind) {
+            producer.text.append(record.text, record.length);
+            if (true == record.continued) {
+                return;
+            }
+            if (allow(std::hash<std::string>{}(producer.text), record.timestampNs)) {
+                auto &stream = record.level >= LogLevel::Warning ? std::cerr : std::cout;
+                stream << producer.text << "\n";
+            }
+            producer.text.clear();
+            return;
+        }
+
+        if (LogRecord::Kind::Tick == record.kind) {
+            producer.tickAllowed = allow(0, record.timestampNs);
+            if (false == producer.tickAllowed) {
+                return;
+            }
+            producer.hasClockOffset = record.hasClockOffset;
+            producer.clockOffsetNs = record.clockOffsetNs;
+
+            std::string identifier{};
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                identifier = _identifier;
+            }
+            std::cout << "id: " << identifier
+                      << "; c_time: " << record.currentTime
+                      << "; late_us: " << record.latenessNs / 1000
+                      << "; error: ";
+            if (true == record.trackingNodeNotFound) {
+                std::cout << errorToString(Antilatency::IpNetwork::ErrorType::TrackingNodeNotFound) << " ";
+            }
+            if (true == record.setupGpioFailed) {
+                std::cout << errorToString(Antilatency::IpNetwork::ErrorType::SetupGpio) << " ";
+            }
+            std::cout << "; gpio: ";
+            if (true == record.hasGpio) {
+                std::cout << "0x" << std::hex << std::setw(8) << std::setfill('0') << record.gpioMask << std::dec;
+            } else {
+                std::cout << "-";
+            }
+            std::cout << "\n";
+            return;
+        }
+
+        if (false == producer.tickAllowed) {
+            return;
+        }
+
+        std::function<std::string(const Antilatency::IpNetwork::RawString32 &)> tagFormatter{};
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            tagFormatter = _tagFormatter;
+        }
+        const auto &pose = record.pose;
+        std::cout << "\t"
+                  << "tag: " << (tagFormatter ? tagFormatter(pose.rawTag) : std::string{})
+                  << "; err: "  << errorToString(pose.trackerError);
+        // Sample time in the IP Network time, comparable with c_time
+        if (true == producer.hasClockOffset) {
+            std::cout << "; s_time: " << (record.sampleTimeNs + producer.clockOffsetNs) / 1000;
+        } else {
+            std::cout << "; s_time: -";
+        }
+        // With --adaptive-rate
+        if (record.sendRateHz > 0.0f) {
+            std::cout << "; rate: " << record.sendRateHz;
+        }
+        std::cout
+                  << "; posX: " << pose.positionX
+                  << "; posY: " << pose.positionY
+                  << "; posZ: " << pose.positionZ
+                  << "; rotX: " << pose.rotationX
+                  << "; rotY: " << pose.rotationY
+                  << "; rotZ: " << pose.rotationZ
+                  << "; rotW: " << pose.rotationW
+                  << "\n";
+    }
+
+    // Token bucket per message key, one second worth of burst
+    bool allow(std::size_t key, std::int64_t timestampNs) {
+        std::uint32_t rate = _rateLimit.load(std::memory_order_relaxed);
+        if (0 == rate) {
+            return true;
+        }
+
+        auto &bucket = _buckets[key];
+        if (0 == bucket.updatedNs) {
+            bucket.tokens = rate;
+        } else {
+            double elapsed = static_cast<double>(timestampNs - bucket.updatedNs) / 1e9;
+            bucket.tokens = std::min<double>(rate, bucket.tokens + elapsed * rate);
+        }
+        bucket.updatedNs = timestampNs;
+
+        if (bucket.tokens < 1.0) {
+            _suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        bucket.tokens -= 1.0;
+        return true;
+    }
+
+    // Messages with numbers or tags in them get a bucket each; one idle for a
+    // second is full again, the same as a new one, so it is dropped
+    void evictIdleBuckets(std::int64_t nowNs) {
+        for (auto bucket = _buckets.begin(); bucket != _buckets.end();) {
+            if (nowNs - bucket->second.updatedNs >= 1000000000) {
+                bucket = _buckets.erase(bucket);
+            } else {
+                ++bucket;
+            }
+        }
+    }
+
+    mutable std::mutex _mutex{};
+    std::condition_variable _wakeUp{};
+    bool _running = true;
+    std::vector<std::unique_ptr<Producer>> _producers{};
+
+    std::atomic<LogLevel> _level{LogLevel::Info};
+    std::atomic<std::uint32_t> _rateLimit{0};
+    std::atomic<std::uint64_t> _suppressed{0};
+    std::string _identifier{};
+    std::function<std::string(const Antilatency::IpNetwork::RawString32 &)> _tagFormatter{};
+
+    // Owned by the logger thread
+    LogRecord _record{};
+    std::unordered_map<std::size_t, Bucket> _buckets{};
+
+    std::thread _thread;
+};
+
+}
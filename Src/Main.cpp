@@ -4,13 +4,29 @@
 #include <chrono>
 #include <stdexcept>
 #include <iostream>
-
-#include <wiringPi.h>
+#include <future>
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
 
 #include <Antilatency.Api.h>
 #include <Antilatency.InterfaceContract.LibraryLoader.h>
 
+#include "AllocationCounter.h"
+#include "Backend.h"
+#include "CompactUdpSink.h"
+#include "ConfigWatcher.h"
+#include "FanOutSink.h"
+#include "Gpio.h"
 #include "Parameters.h"
+#include "ProviderEngine.h"
+#include "Recording.h"
+#include "SdkBackend.h"
+#include "SharedPosePublisher.h"
+#include "Startup.h"
+#include "StateSender.h"
+#include "Telemetry.h"
+#include "TickScheduler.h"
 
 #ifndef ANTILATENCY_PACKAGE_DIR
 #   define ANTILATENCY_PACKAGE_DIR "./"
@@ -28,14 +44,6 @@
 #   define ANTILATENCY_IP_NETWORK_LIB ANTILATENCY_PACKAGE_DIR "/lib/libAntilatencyIpNetwork.so"
 #endif
 
-namespace Antilatency::IpTrackingDemoProvider {
-struct TrackingNode {
-    Antilatency::DeviceNetwork::NodeHandle node = Antilatency::DeviceNetwork::NodeHandle::Null;
-    Antilatency::Alt::Tracking::ITrackingCotask trackingCotask = nullptr;
-    Antilatency::IpNetwork::RawString32 tag{};
-};
-}
-
 using namespace Antilatency::IpTrackingDemoProvider;
 using namespace Antilatency::IpNetwork;
 
@@ -58,7 +66,92 @@ std::string getInterfaceMacAddress(const std::string &ifname) {
     return "00:00:00:00:00:00";
 }
 
+// Sends a recording made with --record to the receiver, paced by the recorded
+// timestamps divided by speed; a speed of 0 sends as fast as possible
+int replay(const Parameters &params, NetworkSink &sink) {
+    RecordReader reader{};
+    if (false == reader.open(params.replayFile)) {
+        printError("Could not open recording " + params.replayFile, true);
+        return 1;
+    }
+    if (0 != reader.getInvalidTail()) {
+        printError(std::to_string(reader.getInvalidTail()) + " bytes at the end of "
+                       + params.replayFile + " are not a complete record, skipped",
+                   true);
+    }
+
+    RecordedState state{};
+    std::vector<Antilatency::IpNetwork::GpioPinState> gpioState{};
+    do {
+        reader.rewind();
+        std::int64_t firstNs = 0;
+        std::int64_t startNs = TickScheduler::now();
+        bool first = true;
+        while (reader.next(state)) {
+            if (true == first) {
+                firstNs = state.timestampNs;
+                first = false;
+            }
+            if (params.replaySpeed > 0.0) {
+                auto offsetNs = static_cast<std::int64_t>(static_cast<double>(state.timestampNs - firstNs) / params.replaySpeed);
+                timespec deadline{};
+                deadline.tv_sec = static_cast<time_t>((startNs + offsetNs) / 1000000000);
+                deadline.tv_nsec = static_cast<long>((startNs + offsetNs) % 1000000000);
+                while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr)) {}
+            }
+
+            gpioState.clear();
+            if (true == state.hasGpio) {
+                GpioSource::toPinStates(state.gpioMask, gpioState);
+            }
+            try {
+                // The recording keeps no sample times, the poses count as just sampled
+                sink.sendStateMessages(state.poses, gpioState, state.error, {});
+            } catch (const std::exception &ex) {
+                printError(ex.what(), params.verbose);
+            }
+        }
+        if (true == first) {
+            printError("Recording " + params.replayFile + " holds no records", true);
+            return 1;
+        }
+    } while (true == params.replayLoop);
+
+    return 0;
+}
+
+// The running engine, stopped by SIGINT and SIGTERM and asked for the jitter
+// report by SIGUSR1
+std::atomic<ProviderEngine *> signalledEngine{nullptr};
+
+void onSignal(int signalNumber) {
+    ProviderEngine *engine = signalledEngine.load();
+    if (nullptr == engine) {
+        return;
+    }
+    if (SIGUSR1 == signalNumber) {
+        engine->requestJitterReport();
+    } else {
+        engine->stop();
+    }
+}
+
+void installSignalHandlers() {
+    struct sigaction action{};
+    action.sa_handler = onSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR1, &action, nullptr);
+    // A second SIGINT or SIGTERM kills the process if shutting down hangs
+    action.sa_flags = SA_RESETHAND;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+}
+
 int main(int argc, char *argv[]) {
+    // Lets wiringPi report failures instead of terminating the process. Set
+    // before any thread is started, as setenv races with every getenv
+    setenv("WIRINGPI_CODES", "1", 1);
+
     auto params = Parameters();
     try {
         params = ParametersParser::getParameters(argc, argv);
@@ -71,12 +164,102 @@ int main(int argc, char *argv[]) {
         return 0;
     }
 
+    Logger::instance().setLevel(params.logLevel);
+    Logger::instance().setRateLimit(params.logRate);
+    Logger::instance().setIdentifier(params.identifier);
+
+    Startup startup(params);
+    bool tracking = params.replayFile.empty();
+    GpioBank gpioBank{};
+
+    // The tracking libraries and GPIO do not depend on each other nor on the
+    // IP Network, so they come up concurrently with it. Failures are reported
+    // below in the original order, once the receiver is reachable.
+    std::future<Antilatency::DeviceNetwork::ILibrary> adnLibraryFuture{};
+    std::future<Antilatency::DeviceNetwork::INetwork> deviceNetworkFuture{};
+    std::future<Antilatency::Alt::Tracking::ILibrary> altTrackingLibraryFuture{};
+    std::future<Antilatency::Alt::Tracking::ITrackingCotaskConstructor> cotaskConstructorFuture{};
+    std::future<Antilatency::Alt::Tracking::IEnvironment> environmentFuture{};
+    std::future<void> gpioFuture{};
+    if (true == tracking) {
+        std::promise<Antilatency::DeviceNetwork::ILibrary> adnLibraryPromise{};
+        adnLibraryFuture = adnLibraryPromise.get_future();
+        deviceNetworkFuture = std::async(std::launch::async,
+                                         [&startup, &params, adnLibraryPromise = std::move(adnLibraryPromise)]() mutable {
+            std::int64_t startNs = TickScheduler::now();
+            Antilatency::DeviceNetwork::ILibrary library{};
+            try {
+                library = Antilatency::InterfaceContract::getLibraryInterface
+                              <Antilatency::DeviceNetwork::ILibrary>(ADN_LIBRARY);
+            } catch (...) {
+                adnLibraryPromise.set_exception(std::current_exception());
+                return Antilatency::DeviceNetwork::INetwork{};
+            }
+            adnLibraryPromise.set_value(library);
+            if (library == nullptr) {
+                return Antilatency::DeviceNetwork::INetwork{};
+            }
+            if (params.verbose) {
+                library.setLogLevel(Antilatency::DeviceNetwork::LogLevel::Info);
+            } else {
+                library.setLogLevel(Antilatency::DeviceNetwork::LogLevel::Off);
+            }
+            auto network = library.createNetwork({SocketNewId, SocketOldId});
+            startup.record("device network", startNs);
+            return network;
+        });
+
+        std::promise<Antilatency::Alt::Tracking::ILibrary> altTrackingLibraryPromise{};
+        std::promise<Antilatency::Alt::Tracking::IEnvironment> environmentPromise{};
+        altTrackingLibraryFuture = altTrackingLibraryPromise.get_future();
+        environmentFuture = environmentPromise.get_future();
+        cotaskConstructorFuture = std::async(std::launch::async,
+                                             [&startup, &params,
+                                              altTrackingLibraryPromise = std::move(altTrackingLibraryPromise),
+                                              environmentPromise = std::move(environmentPromise)]() mutable {
+            std::int64_t startNs = TickScheduler::now();
+            Antilatency::Alt::Tracking::ILibrary library{};
+            try {
+                library = Antilatency::InterfaceContract::getLibraryInterface
+                              <Antilatency::Alt::Tracking::ILibrary>(ALT_TRACKING_LIBRARY);
+            } catch (...) {
+                altTrackingLibraryPromise.set_exception(std::current_exception());
+                environmentPromise.set_value({});
+                return Antilatency::Alt::Tracking::ITrackingCotaskConstructor{};
+            }
+            altTrackingLibraryPromise.set_value(library);
+            if (library == nullptr) {
+                environmentPromise.set_value({});
+                return Antilatency::Alt::Tracking::ITrackingCotaskConstructor{};
+            }
+
+            // The first tick creates the environment otherwise; an invalid
+            // code is left for it to report
+            Antilatency::Alt::Tracking::IEnvironment environment{};
+            try {
+                environment = library.createEnvironment(params.environmentCode);
+            } catch (const std::exception &) {}
+            environmentPromise.set_value(environment);
+
+            auto cotaskConstructor = library.createTrackingCotaskConstructor();
+            startup.record("alt tracking", startNs);
+            return cotaskConstructor;
+        });
+
+        gpioFuture = std::async(std::launch::async, [&startup, &params, &gpioBank] {
+            std::int64_t startNs = TickScheduler::now();
+            gpioBank.setup(params.gpioPinsDefaultState, params.gpioKeyframeInterval);
+            startup.record("gpio", startNs);
+        });
+    }
+
     Antilatency::DeviceNetwork::ILibrary adnLibrary{};
     Antilatency::Alt::Tracking::ILibrary altTrackingLibrary{};
     Antilatency::DeviceNetwork::INetwork deviceNetwork{};
-    Antilatency::Alt::Tracking::IEnvironment environment{};
     Antilatency::Alt::Tracking::ITrackingCotaskConstructor cotaskConstructor{};
+    Antilatency::Alt::Tracking::IEnvironment environment{};
 
+    std::int64_t ipNetworkStartNs = TickScheduler::now();
     Antilatency::IpNetwork::ILibrary ainLibrary{};
     ainLibrary = Antilatency::InterfaceContract::getLibraryInterface
             <Antilatency::IpNetwork::ILibrary>(ANTILATENCY_IP_NETWORK_LIB);
@@ -86,6 +269,9 @@ int main(int argc, char *argv[]) {
                    true);
         return 1;
     }
+    Logger::instance().setTagFormatter(
+        [ainLibrary](const RawString32 &rawTag) mutable { return ainLibrary.getTagFromRawTag(rawTag); });
+
     auto id = getInterfaceMacAddress("wlan0");
     Antilatency::IpNetwork::INetworkServer netServer = ainLibrary.getNetworkServer(
                 id,
@@ -95,32 +281,60 @@ int main(int argc, char *argv[]) {
                 Constants::DefaultCommandPort
                 );
 
+    SdkNetworkSink primarySink(ainLibrary, netServer, id);
+    FanOutSink sink(primarySink);
+    for (const auto &receiver : params.receivers) {
+        auto receiverServer = ainLibrary.getNetworkServer(
+                    id,
+                    Constants::DefaultIfaceAddress,
+                    receiver.address,
+                    std::stoi(receiver.port),
+                    Constants::DefaultCommandPort
+                    );
+        sink.addDestination(receiver.address + ":" + receiver.port,
+                            std::make_unique<SdkNetworkSink>(ainLibrary, receiverServer, id),
+                            receiver.rateDivider,
+                            receiver.tags);
+    }
+    for (const auto &receiver : params.compactReceivers) {
+        std::unique_ptr<CompactUdpSink> compactSink{};
+        try {
+            compactSink = std::make_unique<CompactUdpSink>(primarySink, receiver.address, receiver.port);
+        } catch (const std::exception &ex) {
+            printError(ex.what(), true);
+            return 1;
+        }
+        sink.addDestination("compact " + receiver.address + ":" + receiver.port,
+                            std::move(compactSink),
+                            receiver.rateDivider,
+                            receiver.tags);
+    }
+
+    startup.record("ip network", ipNetworkStartNs);
+
+    if (false == tracking) {
+        return replay(params, sink);
+    }
+
     try {
-        adnLibrary = Antilatency::InterfaceContract::getLibraryInterface
-                        <Antilatency::DeviceNetwork::ILibrary>(ADN_LIBRARY);
+        adnLibrary = adnLibraryFuture.get();
         if (adnLibrary == nullptr) {
             printError(Antilatency::enumToString(ErrorType::AdnLibraryLoad), true);
             netServer.sendStateMessages({}, {}, Antilatency::enumToString(ErrorType::AdnLibraryLoad));
             return 1;
         }
-        if (params.verbose) {
-            adnLibrary.setLogLevel(Antilatency::DeviceNetwork::LogLevel::Info);
-        } else {
-            adnLibrary.setLogLevel(Antilatency::DeviceNetwork::LogLevel::Off);
-        }
 
-        deviceNetwork = adnLibrary.createNetwork({SocketNewId, SocketOldId});
+        deviceNetwork = deviceNetworkFuture.get();
 
-        altTrackingLibrary = Antilatency::InterfaceContract::getLibraryInterface
-                <Antilatency::Alt::Tracking::ILibrary>(ALT_TRACKING_LIBRARY);
+        altTrackingLibrary = altTrackingLibraryFuture.get();
         if (altTrackingLibrary == nullptr) {
             printError(Antilatency::enumToString(ErrorType::AltTrackingLibraryLoad), true);
             netServer.sendStateMessages({}, {}, Antilatency::enumToString(ErrorType::AltTrackingLibraryLoad));
             return 1;
         }
 
-        cotaskConstructor = altTrackingLibrary.createTrackingCotaskConstructor();
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        environment = environmentFuture.get();
+        cotaskConstructor = cotaskConstructorFuture.get();
         if (cotaskConstructor == nullptr) {
             printError(Antilatency::enumToString(ErrorType::TrakingCotaskConstructFailed), true);
             netServer.sendStateMessages({} , {}, Antilatency::enumToString(ErrorType::TrakingCotaskConstructFailed));
@@ -132,259 +346,63 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    int setupGpio = wiringPiSetup();
-
-    if (0 == setupGpio ) {
-        for (auto gpioPin : params.gpioPinsDefaultState) {
-            pinMode(gpioPin.wiringPiPinNumber, gpioPin.mode);
-            digitalWrite(gpioPin.wiringPiPinNumber, gpioPin.value);
-        }
+    SdkTrackingBackend backend(deviceNetwork, altTrackingLibrary, cotaskConstructor, params.environmentCacheSize);
+    if (environment != nullptr) {
+        backend.adoptEnvironment(params.environmentCode, environment);
     }
 
-    std::string prevEnvCode{};
-    std::uint32_t prevUpdateId = 0;
-    std::vector<TrackingNode> trackingNodes{};
+    gpioFuture.get();
 
     try {
-        netServer.startCommandListening();
+        sink.startCommandListening();
     } catch (const std::exception &ex) {
         printError(ex.what(), params.verbose);
         netServer.sendStateMessages({} , {}, ex.what());
     }
 
-    while (true) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(params.waitTime));
-
-        try {
-            auto commands = netServer.getCommands();
-            for (std::size_t index = 0; index < commands.size(); index++) {
-                auto command = commands.get(index);
-                if (command.key() == CommandKey::SetEnvinromentCode) {
-                    params.environmentCode = command.value();
-                } else if (command.key() == CommandKey::SetSendingRate) {
-                    params.waitTime = std::stoi(command.value());
-                }
-
-                printMessage(Antilatency::enumToString(command.key()), params.verbose);
-                netServer.sendStateMessages({} , {}, Antilatency::enumToString(command.key()));
-            }
-        } catch (const std::exception &ex) {
-            try {
-                netServer.sendStateMessages({}, {}, ex.what());
-            } catch (const std::exception &ex) {
-                printError(ex.what(), params.verbose);
-            }
-            printError(ex.what(), params.verbose);
-            continue;
-        }
-
-        std::vector<GpioPinState> gpioState{};
-        if (0 == setupGpio) {
-            for (std::size_t index = 0; index < 28; index++) {
-                if (index == 17) {
-                    index = index + 4;
-                }
-                GpioPinState pin;
-                pin.number = index;
-                pin.value = digitalRead(index);
-
-                gpioState.push_back(pin);
-            }
-        }
-
-        if (prevEnvCode != params.environmentCode) {
-            try {
-                environment = altTrackingLibrary.createEnvironment(params.environmentCode);
-
-                prevUpdateId--;
-
-                if (environment == nullptr) {
-                    printError("Could not create environment: " + params.environmentCode, params.verbose);
-                    netServer.sendStateMessages({}, {}, "Could not create environment: " + params.environmentCode);
-                    continue;
-                }
-            } catch (const std::exception &) {
-                try {
-                    netServer.sendStateMessages(
-                        {},
-                        gpioState,
-                        Antilatency::enumToString(ErrorType::AltEnvironmentArbitrary2D)
-                        );
-                } catch (const std::exception &ex) {
-                    printError(ex.what(), params.verbose);
-                }
-                printError(Antilatency::enumToString(ErrorType::AltEnvironmentArbitrary2D),
-                           params.verbose);
-                continue;
-            }
-
-            prevEnvCode = params.environmentCode;
-
-            printMessage("New environment: "+params.environmentCode, params.verbose);
-            try {
-                netServer.sendStateMessages({}, {}, "New environment: "+params.environmentCode);
-            } catch (const std::exception &ex) {
-                printError(ex.what(), params.verbose);
-            }
-        }
-
-        if (prevUpdateId != deviceNetwork.getUpdateId()) {
-            trackingNodes = {};
-
-            auto nodes = cotaskConstructor.findSupportedNodes(deviceNetwork);
-            if (nodes.empty()) {
-                try {
-                    netServer.sendStateMessages(
-                        {},
-                        gpioState,
-                        Antilatency::enumToString(ErrorType::TrackingNodeNotFound)
-                        );
-                } catch (const std::exception &ex) {
-                    printError(ex.what(), params.verbose);
-                }
-                printError(Antilatency::enumToString(ErrorType::TrackingNodeNotFound),
-                           params.verbose);
-                continue;
-            }
-
-            for (auto node : nodes) {
-                if (deviceNetwork.nodeGetStatus(node) == Antilatency::DeviceNetwork::NodeStatus::Idle) {
-                    if (node != Antilatency::DeviceNetwork::NodeHandle::Null) {
-                        TrackingNode trackingNode;
-                        trackingNode.node = node;
-
-                        auto parent = deviceNetwork.nodeGetParent(node);
-                        std::string tag{};
-                        try {
-                            tag = deviceNetwork.nodeGetStringProperty(parent, "Tag");
-                        } catch (const std::exception &ex) {
-                            printError(ex.what(), params.verbose);
-                        }
-
-                        if (true == tag.empty()) {
-                            try {
-                                tag = deviceNetwork.nodeGetStringProperty(
-                                          parent,
-                                          Antilatency::DeviceNetwork::Interop
-                                              ::Constants::HardwareSerialNumberKey
-                                          );
-                            } catch (const std::exception &ex) {
-                                printError(ex.what(), params.verbose);
-                            }
-                        }
-
-                        trackingNode.tag = ainLibrary.getRawTagFromString(tag);
-
-                        try {
-                            trackingNode.trackingCotask =
-                                cotaskConstructor.startTask(deviceNetwork, node, environment);
-
-                            printMessage("Started tracking task", params.verbose);
-                            netServer.sendStateMessages({}, {}, "Started tracking task");
-                        } catch (const std::exception &ex) {
-                            printError(ex.what(), params.verbose);
-                        }
-
-                        trackingNodes.push_back(trackingNode);
-                    }
-                }
-            }
-
-            prevUpdateId = deviceNetwork.getUpdateId();
-        }
+    Telemetry telemetry(params.telemetryFile, params.telemetryInterval);
+    sink.attachTelemetry(telemetry);
+    telemetry.start();
 
-        std::vector<StateMessage> poses{};
-
-        for (TrackingNode trackingNode : trackingNodes) {
-            StateMessage poseSample{};
-
-            poseSample.trackerError = ErrorType::None;
-
-            if (trackingNode.trackingCotask == nullptr) {
-                poseSample.trackerError = ErrorType::TrakingCotaskConstructFailed;
-                printError(
-                    std::to_string(static_cast<uint32_t>(trackingNode.node))
-                        + ": "
-                        + Antilatency::enumToString(ErrorType::TrakingCotaskConstructFailed),
-                    params.verbose
-                    );
-
-                continue;
-            }
-
-            if (trackingNode.trackingCotask.isTaskFinished()) {
-                poseSample.trackerError = ErrorType::TrackingTaskRestartMessage;
-                printError(
-                    std::to_string(static_cast<uint32_t>(trackingNode.node))
-                        + ": "
-                        + Antilatency::enumToString(ErrorType::TrackingTaskRestartMessage),
-                    params.verbose
-                    );
-                trackingNode.trackingCotask = cotaskConstructor.startTask(deviceNetwork, trackingNode.node, environment);
-                continue;
-            }
-
-            try {
-                auto state = trackingNode.trackingCotask.getState(
-                            Antilatency::Alt::Tracking::Constants::DefaultAngularVelocityAvgTime
-                            );
-
-                poseSample.positionX = state.pose.position.x;
-                poseSample.positionY = state.pose.position.y;
-                poseSample.positionZ = state.pose.position.z;
-                poseSample.rotationX = state.pose.rotation.x;
-                poseSample.rotationY = state.pose.rotation.y;
-                poseSample.rotationZ = state.pose.rotation.z;
-                poseSample.rotationW = state.pose.rotation.w;
-            } catch(const std::exception &) {
-                poseSample.trackerError = ErrorType::GetTrackerStateFailed;
-            }
-
-            poseSample.rawTag = trackingNode.tag;
-            poses.push_back(poseSample);
-        }
+    RecordWriter recorder{};
+    std::string recordError{};
+    if (false == params.recordFile.empty() && false == recorder.open(params.recordFile, recordError)) {
+        printError("Could not open recording " + params.recordFile + ": " + recordError, true);
+    }
 
-        std::string deviceError{};
+    StateSender stateSender(sink, params);
+    stateSender.attachGpio(gpioBank);
+    stateSender.attachTelemetry(telemetry);
+    if (true == recorder.isOpen()) {
+        stateSender.attachRecorder(recorder);
+    }
+    stateSender.start();
 
-        if (true == trackingNodes.empty()) {
-            deviceError += Antilatency::enumToString(ErrorType::TrackingNodeNotFound) + std::string(" ");
-        }
-        if (0 != setupGpio) {
-            deviceError += Antilatency::enumToString(ErrorType::SetupGpio) + std::string(" ");
-        }
+    SharedPosePublisher sharedPoses{};
+    if (false == params.sharedPoses.empty() && false == sharedPoses.open(params.sharedPoses)) {
+        printError("Could not create shared memory " + params.sharedPoses, true);
+    }
 
-        if (true == params.verbose) {
-            std::stringstream output{};
-            output << "id: " << params.identifier
-                   << "; c_time: " << ainLibrary.getCurrentTime()
-                   << "; error: " << deviceError
-                   << "; gpio: ";
-            for (auto pin : gpioState) {
-                output << pin.value;
-            }
-            for (auto const &pose : poses) {
-                output << "\n\t"
-                       << "tag: " << ainLibrary.getTagFromRawTag(pose.rawTag)
-                       << "; err: "  << Antilatency::enumToString(pose.trackerError)
-                       << "; posX: " << pose.positionX
-                       << "; posY: " << pose.positionY
-                       << "; posZ: " << pose.positionZ
-                       << "; rotX: " << pose.rotationX
-                       << "; rotY: " << pose.rotationY
-                       << "; rotZ: " << pose.rotationZ
-                       << "; rotW: " << pose.rotationW;
-            }
-            output << "\n";
-            std::cout << output.str();
-            std::flush(std::cout);
-        }
+    // Applied by the engine, so it outlives the engine
+    std::unique_ptr<ConfigWatcher> configWatcher{};
+    if (false == params.configFile.empty()) {
+        configWatcher = std::make_unique<ConfigWatcher>(argc, argv, params, sink);
+    }
 
-        try {
-            netServer.sendStateMessages(poses, gpioState, deviceError);
-        } catch (const std::exception &ex) {
-            printError(ex.what(), params.verbose);
-        }
+    ProviderEngine engine(params, backend, sink, gpioBank, stateSender, telemetry);
+    engine.attachStartup(startup);
+    if (nullptr != configWatcher) {
+        engine.attachConfigWatcher(*configWatcher);
+    }
+    if (true == sharedPoses.isOpen()) {
+        engine.attachSharedPoses(sharedPoses);
     }
+    signalledEngine = &engine;
+    installSignalHandlers();
+    engine.run();
+    signalledEngine = nullptr;
+
+    printMessage(engine.getJitterReport(), true);
 
     return 0;
 }
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include <Antilatency.Api.h>
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+// Extrapolates a tracker pose by the horizon using the linear and angular
+// velocities AltTracking reports with it, so the pose matches the moment it
+// is expected to be used by the receiver rather than the moment it was
+// sampled. Velocities above the limits are clamped to them, non-finite ones
+// disable the prediction for that sample.
+class MotionPredictor {
+public:
+    MotionPredictor(std::int32_t horizonMs, float maxSpeed, float maxAngularSpeed) :
+        _maxSpeed(maxSpeed),
+        _maxAngularSpeed(maxAngularSpeed)
+    {
+        setHorizon(horizonMs);
+    }
+
+    void setHorizon(std::int32_t horizonMs) {
+        _horizon = static_cast<float>(horizonMs > 0 ? horizonMs : 0) / 1000.0f;
+    }
+
+    bool isEnabled() const {
+        return _horizon > 0.0f;
+    }
+
+    Antilatency::Math::floatP3Q predict(const Antilatency::Alt::Tracking::State &state) const {
+        Antilatency::Math::floatP3Q pose = state.pose;
+        if (false == isEnabled()) {
+            return pose;
+        }
+
+        Antilatency::Math::float3 velocity = state.velocity;
+        if (true == clamp(velocity, _maxSpeed)) {
+            pose.position.x += velocity.x * _horizon;
+            pose.position.y += velocity.y * _horizon;
+            pose.position.z += velocity.z * _horizon;
+        }
+
+        // The angular velocity is in the tracker frame, so the rotation over
+        // the horizon is applied on the right: q' = q * exp(w * h / 2)
+        Antilatency::Math::float3 angularVelocity = state.localAngularVelocity;
+        if (true == clamp(angularVelocity, _maxAngularSpeed)) {
+            float speed = length(angularVelocity);
+            if (speed > 1e-6f) {
+                float halfAngle = speed * _horizon / 2.0f;
+                float scale = std::sin(halfAngle) / speed;
+                Antilatency::Math::floatQ delta{};
+                delta.x = angularVelocity.x * scale;
+                delta.y = angularVelocity.y * scale;
+                delta.z = angularVelocity.z * scale;
+                delta.w = std::cos(halfAngle);
+                pose.rotation = normalize(multiply(pose.rotation, delta));
+            }
+        }
+
+        return pose;
+    }
+
+private:
+    static float length(const Antilatency::Math::float3 &value) {
+        return std::sqrt(value.x * value.x + value.y * value.y + value.z * value.z);
+    }
+
+    // Scales value down to the limit, returns false if it is not finite
+    static bool clamp(Antilatency::Math::float3 &value, float limit) {
+        float valueLength = length(value);
+        if (false == std::isfinite(valueLength)) {
+            return false;
+        }
+        if (valueLength > limit) {
+            float scale = limit / valueLength;
+            value.x *= scale;
+            value.y *= scale;
+            value.z *= scale;
+        }
+        return true;
+    }
+
+    static Antilatency::Math::floatQ multiply(const Antilatency::Math::floatQ &a, const Antilatency::Math::floatQ &b) {
+        Antilatency::Math::floatQ result{};
+        result.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+        result.y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+        result.z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+        result.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+        return result;
+    }
+
+    static Antilatency::Math::floatQ normalize(const Antilatency::Math::floatQ &value) {
+        float norm = std::sqrt(value.x * value.x + value.y * value.y + value.z * value.z + value.w * value.w);
+        if (norm < 1e-6f) {
+            return value;
+        }
+        return {value.x / norm, value.y / norm, value.z / norm, value.w / norm};
+    }
+
+    const float _maxSpeed;
+    const float _maxAngularSpeed;
+    float _horizon = 0.0f;
+};
+
+}
@@ -9,12 +9,20 @@
 #include <fstream>
 #include <iostream>
 #include <array>
+#include <cmath>
 #include <cstring>
+#include <string_view>
+
+#include <sched.h>
 
 #include <cxxopts.hpp>
 
 #include <Antilatency.Api.h>
 
+#include "Log.h"
+#include "SpscRing.h"
+#include "TickScheduler.h"
+
 namespace Antilatency::IpTrackingDemoProvider {
 
 const std::array<std::uint8_t, 28> wiringPiPins
@@ -29,15 +37,37 @@ struct GpioPin {
     std::int8_t value = -1;
 };
 
-void printMessage(const std::string &message, bool verbose = false) {
+// Additional destination of the tracking data
+struct ReceiverSpec {
+    std::string address{};
+    std::string port{};
+    // Only every rateDivider-th packet is sent to the receiver
+    std::uint32_t rateDivider = 1;
+    // Tags of the nodes sent to the receiver, all nodes if empty
+    std::vector<std::string> tags{};
+};
+
+// One-Euro filter settings, see PoseSmoother.h
+struct SmoothingSpec {
+    // Nodes with this tag, empty for all nodes
+    std::string tag{};
+    // Cutoff frequency of a still tracker, Hz
+    float minCutoff = 1.0f;
+    // Cutoff increase per m/s or rad/s
+    float beta = 0.5f;
+    // Cutoff frequency of the speed estimate, Hz
+    float derivativeCutoff = 1.0f;
+};
+
+void printMessage(std::string_view message, bool verbose = false) {
     if (verbose) {
-        std::cout << message << "\n";
+        Logger::instance().write(LogLevel::Info, message);
     }
 }
 
-void printError(const std::string &message, bool verbose = false) {
+void printError(std::string_view message, bool verbose = false) {
     if (verbose) {
-        std::cerr << message << "\n";
+        Logger::instance().write(LogLevel::Error, message);
     }
 }
 
@@ -59,12 +89,56 @@ public:
     std::string processName{};
     std::string receiver{};
     std::string port = std::to_string(Antilatency::IpNetwork::Constants::DefaultTrackingPort);
+    std::vector<ReceiverSpec> receivers{};
+    // Receivers of the compact encoding in CompactWire.h
+    std::vector<ReceiverSpec> compactReceivers{};
     std::string environmentCode = "AAVSaWdpZBcABnllbGxvdwQEBAABAQMBAQEDAAEAAD_W";
     std::string identifier = "";
+    // False for the random identifier
+    bool hasIdentifier = false;
     std::string configFile = "";
     std::int32_t waitTime = 200;
+    std::int32_t sendInterval = 0;
+    OverrunPolicy overrunPolicy = OverrunPolicy::Skip;
+    std::size_t queueSize = 8;
+    OverflowPolicy overflowPolicy = OverflowPolicy::DropOldest;
+    std::int32_t restartBackoff = 100;
+    std::int32_t restartBackoffMax = 5000;
+    std::uint32_t samplingThreads = 1;
+    bool realtime = false;
+    std::int32_t realtimePriority = 80;
+    // -1 is the last CPU
+    std::int32_t realtimeCpu = -1;
+    std::int32_t predictionHorizon = 0;
+    float predictionMaxSpeed = 10.0f;
+    float predictionMaxAngularSpeed = 30.0f;
+    bool smoothing = false;
+    SmoothingSpec smoothingDefault{};
+    std::vector<SmoothingSpec> smoothingTags{};
+    bool delta = false;
+    float deltaPosition = 1.0f;
+    float deltaRotation = 0.5f;
+    std::int32_t keyframeInterval = 1000;
+    bool adaptiveRate = false;
+    std::int32_t adaptiveRateMaxInterval = 100;
+    float adaptiveRateSpeed = 1.0f;
+    float adaptiveRateAngularSpeed = 3.0f;
+    std::int32_t adaptiveRateDecay = 1000;
     std::string tag{};
     std::vector<GpioPin> gpioPinsDefaultState{};
+    std::int32_t gpioKeyframeInterval = 1000;
+    LogLevel logLevel = LogLevel::Info;
+    std::uint32_t logRate = 0;
+    std::string telemetryFile{};
+    std::int32_t telemetryInterval = 1000;
+    std::string recordFile{};
+    std::string replayFile{};
+    double replaySpeed = 1.0;
+    bool replayLoop = false;
+    std::string sharedPoses{};
+    std::string readyFile{};
+    std::string controlSocket{};
+    std::size_t environmentCacheSize = 4;
 };
 
 
@@ -80,13 +154,109 @@ public:
             ("v,verbose", "Verbose output", cxxopts::value<bool>())
             ("r,receiver", "Network name or address of Antilatency.RaspberryPiSdk.Unity", cxxopts::value<std::string>())
             ("p,port", "Network port of UdpTrackingReceiver", cxxopts::value<std::string>())
+            ("receivers",
+             "More receivers of the tracking data. Format: 10.0.0.2:12345,10.0.0.3:12345:4:tagA+tagB"
+             " (Address:Port[:RateDivider[:Tags]])",
+             cxxopts::value<std::string>())
+            ("compact-receivers",
+             "Receivers of the tracking data in the compact UDP format, same format as --receivers",
+             cxxopts::value<std::string>())
             ("e,environment", "Tracking environment code", cxxopts::value<std::string>())
             ("w,wait-time", "A number of milliseconds between a new position request", cxxopts::value<std::int32_t>())
+            ("send-interval",
+             "A number of milliseconds between packets, every packet holds all samples taken since the previous one;"
+             " 0 sends every sample as it is taken",
+             cxxopts::value<std::int32_t>())
+            ("overrun-policy",
+             "What to do with deadlines missed by a slow tick: skip or catch-up",
+             cxxopts::value<std::string>())
+            ("queue-size", "A number of batches buffered between sampling and sending, 2 to 1024", cxxopts::value<std::size_t>())
+            ("overflow-policy",
+             "What to do when the send queue is full: drop-oldest or coalesce",
+             cxxopts::value<std::string>())
+            ("restart-backoff",
+             "A number of milliseconds before the first restart of a failed tracking task",
+             cxxopts::value<std::int32_t>())
+            ("restart-backoff-max",
+             "Upper limit of the tracking task restart backoff, milliseconds",
+             cxxopts::value<std::int32_t>())
+            ("realtime",
+             "Run the tick thread with SCHED_FIFO priority on its own CPU and lock the memory",
+             cxxopts::value<bool>())
+            ("realtime-priority", "SCHED_FIFO priority of the tick thread with --realtime, 1 to 99", cxxopts::value<std::int32_t>())
+            ("realtime-cpu", "CPU the tick thread is pinned to with --realtime, -1 is the last one", cxxopts::value<std::int32_t>())
+            ("sampling-threads",
+             "A number of threads sampling the trackers every tick, the tick thread included; 1 samples serially",
+             cxxopts::value<std::uint32_t>())
+            ("prediction-horizon",
+             "Extrapolate poses this many milliseconds ahead of the sample time, 0 disables the prediction",
+             cxxopts::value<std::int32_t>())
+            ("prediction-max-speed", "Velocity used by the prediction is clamped to this many m/s", cxxopts::value<float>())
+            ("prediction-max-angular-speed",
+             "Angular velocity used by the prediction is clamped to this many rad/s",
+             cxxopts::value<float>())
+            ("smoothing", "Smooth poses with a One-Euro filter before the prediction", cxxopts::value<bool>())
+            ("smoothing-params",
+             "Filter settings of all nodes as minCutoff:beta:derivativeCutoff, in Hz, Hz per m/s or rad/s and Hz",
+             cxxopts::value<std::string>())
+            ("smoothing-tags",
+             "Filter settings of the nodes with a tag, e.g. T1:0.5:1:1,T2:2:0.2:1",
+             cxxopts::value<std::string>())
+            ("delta", "Send a pose only when it changed past the thresholds, and every keyframe interval", cxxopts::value<bool>())
+            ("delta-position", "Position change in millimetres that makes a pose to be sent", cxxopts::value<float>())
+            ("delta-rotation", "Rotation change in degrees that makes a pose to be sent", cxxopts::value<float>())
+            ("keyframe-interval",
+             "With --delta, all poses are sent at least every this many milliseconds",
+             cxxopts::value<std::int32_t>())
+            ("adaptive-rate",
+             "Send every node at a rate following its motion, from every tick down to every max interval",
+             cxxopts::value<bool>())
+            ("adaptive-rate-max-interval",
+             "With --adaptive-rate, still nodes are sent every this many milliseconds",
+             cxxopts::value<std::int32_t>())
+            ("adaptive-rate-speed", "With --adaptive-rate, nodes moving this many m/s are sent on every tick", cxxopts::value<float>())
+            ("adaptive-rate-angular-speed",
+             "With --adaptive-rate, nodes turning this many rad/s are sent on every tick",
+             cxxopts::value<float>())
+            ("adaptive-rate-decay",
+             "With --adaptive-rate, time constant in milliseconds of the rate decay of a node slowing down",
+             cxxopts::value<std::int32_t>())
             ("i,identifier", "The identifier of the app instance", cxxopts::value<std::string>())
             ("c,config", "Try to read parameters from a file first (one per line)", cxxopts::value<std::string>())
             ("g,gpio",
              "Set initial state of a GPIO pins. Format: 25:output:high,27:input:low (Number:Mode:Value)",
              cxxopts::value<std::string>())
+            ("log-level", "Lowest level of the logged messages: debug, info, warning, error or off", cxxopts::value<std::string>())
+            ("log-rate",
+             "Not more than this many records per second of every distinct log message, 0 is unlimited",
+             cxxopts::value<std::uint32_t>())
+            ("telemetry",
+             "Periodically write latency histograms and counters to this file, e.g. /run/antilatency/telemetry.json",
+             cxxopts::value<std::string>())
+            ("telemetry-interval", "A number of milliseconds between telemetry snapshots", cxxopts::value<std::int32_t>())
+            ("record", "Append everything sent to the receiver to this file", cxxopts::value<std::string>())
+            ("replay",
+             "Send a recording made with --record instead of tracking, no devices are used",
+             cxxopts::value<std::string>())
+            ("replay-speed", "Replay speed factor, 0 sends as fast as possible", cxxopts::value<double>())
+            ("replay-loop", "Start the replay over when the recording ends", cxxopts::value<bool>())
+            ("environment-cache",
+             "A number of parsed environments kept for switching back to them without parsing again",
+             cxxopts::value<std::size_t>())
+            ("ready-file",
+             "Create this file with the process id once the provider is ready, it is removed at exit",
+             cxxopts::value<std::string>())
+            ("control-socket",
+             "Take commands also from a local datagram socket at this path: environment <code>, rate <ms>, "
+             "horizon <ms>, node <tag> on|off, log-level <level> or telemetry, see CommandChannel.h",
+             cxxopts::value<std::string>())
+            ("shm",
+             "Also publish the latest poses and GPIO state to this POSIX shared memory object for local readers, "
+             "e.g. /antilatency-poses, see SharedPoses.h",
+             cxxopts::value<std::string>())
+            ("gpio-keyframe",
+             "GPIO state is sent on change and at least every this many milliseconds, 0 sends it every tick",
+             cxxopts::value<std::int32_t>())
             ;
 
         cxxopts::ParseResult result = cxxoptsOptions.parse(argc, argv);
@@ -109,27 +279,27 @@ public:
             }
 
             args.insert(args.begin(), std::string(argv[0]));
-            char **tmpArgv = new char*[args.size()];
-            for (std::size_t index = 0; index < args.size(); index++) {
-                tmpArgv[index] = new char[args[index].size() + 1];
-                std::strcpy(tmpArgv[index], args[index].c_str());
+            std::vector<char *> argvFromFile{};
+            for (auto &arg : args) {
+                argvFromFile.push_back(arg.data());
             }
+            argvFromFile.push_back(nullptr);
 
-            std::vector<std::string> argsFromFile(tmpArgv, tmpArgv + args.size());
-            int tmpArgc = args.size();
-            cxxopts::ParseResult argsFromConfig = cxxoptsOptions.parse(tmpArgc, tmpArgv);
+            int argcFromFile = static_cast<int>(args.size());
+            char **argvFromFilePointer = argvFromFile.data();
+            cxxopts::ParseResult argsFromConfig = cxxoptsOptions.parse(argcFromFile, argvFromFilePointer);
             parseArgs(argsFromConfig, params);
 
-            for (std::size_t index = 0; index < args.size(); index++) {
-                delete [] tmpArgv[index];
-            }
-            delete [] tmpArgv;
-
             params.configFile = configFile;
         }
 
         parseArgs(result, params);
 
+        // Both may come from either the file or the command line
+        if (params.restartBackoffMax < params.restartBackoff) {
+            throw std::runtime_error("Restart backoff max must not be less than the restart backoff");
+        }
+
         if (true == params.showUsage) {
             auto help = cxxoptsOptions.help();
             printMessage(help, true);
@@ -221,6 +391,78 @@ private:
         return result;
     }
 
+    static SmoothingSpec parseSmoothingSpec(const std::string &text, bool withTag) {
+        std::stringstream ss(text);
+        std::string tmp{};
+        std::vector<std::string> properties{};
+        while (std::getline(ss, tmp, ':')) {
+            properties.push_back(tmp);
+        }
+
+        std::size_t first = true == withTag ? 1 : 0;
+        if (properties.size() != first + 3 || (true == withTag && true == properties[0].empty())) {
+            throw std::runtime_error("Could not parse smoothing settings: " + text);
+        }
+
+        SmoothingSpec spec{};
+        if (true == withTag) {
+            spec.tag = properties[0];
+        }
+        spec.minCutoff = std::stof(properties[first]);
+        spec.beta = std::stof(properties[first + 1]);
+        spec.derivativeCutoff = std::stof(properties[first + 2]);
+        if (false == (spec.minCutoff > 0.0f) || false == (spec.beta >= 0.0f) || false == (spec.derivativeCutoff > 0.0f)) {
+            throw std::runtime_error("Smoothing cutoffs must be positive and beta not negative: " + text);
+        }
+        return spec;
+    }
+
+    static std::vector<ReceiverSpec> parseReceiversParameter(const std::string &receivers) {
+        std::vector<ReceiverSpec> result{};
+
+        std::string receiver{};
+        std::stringstream ss(receivers);
+        while (std::getline(ss, receiver, ',')) {
+            std::stringstream sss(receiver);
+            std::string tmp{};
+            std::vector<std::string> receiverProperties{};
+
+            while (std::getline(sss, tmp, ':')) {
+                receiverProperties.push_back(tmp);
+            }
+
+            if (receiverProperties.size() < 2 || receiverProperties.size() > 4) {
+                throw std::runtime_error("Could not parse receiver: " + receiver);
+            }
+
+            ReceiverSpec spec{};
+            spec.address = receiverProperties[0];
+            spec.port = receiverProperties[1];
+            if (spec.address.empty() || std::stoi(spec.port) <= 0 || std::stoi(spec.port) > 65535) {
+                throw std::runtime_error("Could not parse receiver address or port: " + receiver);
+            }
+            if (receiverProperties.size() > 2) {
+                int rateDivider = std::stoi(receiverProperties[2]);
+                if (rateDivider < 1) {
+                    throw std::runtime_error("Could not parse receiver rate divider: " + receiver);
+                }
+                spec.rateDivider = static_cast<std::uint32_t>(rateDivider);
+            }
+            if (receiverProperties.size() > 3) {
+                std::stringstream tags(receiverProperties[3]);
+                while (std::getline(tags, tmp, '+')) {
+                    if (false == tmp.empty()) {
+                        spec.tags.push_back(tmp);
+                    }
+                }
+            }
+
+            result.push_back(spec);
+        }
+
+        return result;
+    }
+
     static void parseArgs(const cxxopts::ParseResult &args, Parameters &inParams) {
         if (args.count("help") > 0) {
             inParams.showUsage = true;
@@ -238,16 +480,191 @@ private:
             inParams.port = args["port"].as<std::string>();
         }
 
+        if (args.count("receivers") > 0) {
+            inParams.receivers = parseReceiversParameter(args["receivers"].as<std::string>());
+        }
+
+        if (args.count("compact-receivers") > 0) {
+            inParams.compactReceivers = parseReceiversParameter(args["compact-receivers"].as<std::string>());
+        }
+
         if (args.count("environment") > 0) {
             inParams.environmentCode = args["environment"].as<std::string>();
         }
 
         if (args.count("wait-time") > 0) {
             inParams.waitTime = args["wait-time"].as<std::int32_t>();
+            if (inParams.waitTime < 1) {
+                throw std::runtime_error("Wait time must be at least 1 millisecond");
+            }
+        }
+
+        if (args.count("send-interval") > 0) {
+            inParams.sendInterval = args["send-interval"].as<std::int32_t>();
+            if (inParams.sendInterval < 0) {
+                throw std::runtime_error("Send interval must not be negative");
+            }
+        }
+
+        if (args.count("overrun-policy") > 0) {
+            std::string policy = args["overrun-policy"].as<std::string>();
+            if ("skip" == policy) {
+                inParams.overrunPolicy = OverrunPolicy::Skip;
+            } else if ("catch-up" == policy) {
+                inParams.overrunPolicy = OverrunPolicy::CatchUp;
+            } else {
+                throw std::runtime_error("Could not parse overrun policy: " + policy);
+            }
+        }
+
+        if (args.count("queue-size") > 0) {
+            inParams.queueSize = args["queue-size"].as<std::size_t>();
+            if (inParams.queueSize < 2 || inParams.queueSize > 1024) {
+                throw std::runtime_error("Queue size must be 2 to 1024 batches");
+            }
+        }
+
+        if (args.count("overflow-policy") > 0) {
+            std::string policy = args["overflow-policy"].as<std::string>();
+            if ("drop-oldest" == policy) {
+                inParams.overflowPolicy = OverflowPolicy::DropOldest;
+            } else if ("coalesce" == policy) {
+                inParams.overflowPolicy = OverflowPolicy::Coalesce;
+            } else {
+                throw std::runtime_error("Could not parse overflow policy: " + policy);
+            }
+        }
+
+        if (args.count("restart-backoff") > 0) {
+            inParams.restartBackoff = args["restart-backoff"].as<std::int32_t>();
+            if (inParams.restartBackoff < 1) {
+                throw std::runtime_error("Restart backoff must be at least 1 millisecond");
+            }
+        }
+
+        if (args.count("restart-backoff-max") > 0) {
+            inParams.restartBackoffMax = args["restart-backoff-max"].as<std::int32_t>();
+            if (inParams.restartBackoffMax < 1) {
+                throw std::runtime_error("Restart backoff max must be at least 1 millisecond");
+            }
+        }
+
+        if (args.count("realtime") > 0) {
+            inParams.realtime = args["realtime"].as<bool>();
+        }
+
+        if (args.count("realtime-priority") > 0) {
+            inParams.realtimePriority = args["realtime-priority"].as<std::int32_t>();
+            if (inParams.realtimePriority < 1 || inParams.realtimePriority > 99) {
+                throw std::runtime_error("Realtime priority must be 1 to 99");
+            }
+        }
+
+        if (args.count("realtime-cpu") > 0) {
+            inParams.realtimeCpu = args["realtime-cpu"].as<std::int32_t>();
+            if (inParams.realtimeCpu < -1 || inParams.realtimeCpu >= CPU_SETSIZE) {
+                throw std::runtime_error("Realtime CPU must be -1 to " + std::to_string(CPU_SETSIZE - 1));
+            }
+        }
+
+        if (args.count("sampling-threads") > 0) {
+            inParams.samplingThreads = args["sampling-threads"].as<std::uint32_t>();
+            if (0 == inParams.samplingThreads || inParams.samplingThreads > 16) {
+                throw std::runtime_error("Sampling threads must be 1 to 16");
+            }
+        }
+
+        if (args.count("prediction-horizon") > 0) {
+            inParams.predictionHorizon = args["prediction-horizon"].as<std::int32_t>();
+            if (inParams.predictionHorizon < 0 || inParams.predictionHorizon > 1000) {
+                throw std::runtime_error("Prediction horizon must be 0 to 1000 milliseconds");
+            }
+        }
+
+        if (args.count("prediction-max-speed") > 0) {
+            inParams.predictionMaxSpeed = args["prediction-max-speed"].as<float>();
+            if (false == (inParams.predictionMaxSpeed > 0.0f) || false == std::isfinite(inParams.predictionMaxSpeed)) {
+                throw std::runtime_error("Prediction max speed must be a positive number of m/s");
+            }
+        }
+
+        if (args.count("prediction-max-angular-speed") > 0) {
+            inParams.predictionMaxAngularSpeed = args["prediction-max-angular-speed"].as<float>();
+            if (false == (inParams.predictionMaxAngularSpeed > 0.0f) || false == std::isfinite(inParams.predictionMaxAngularSpeed)) {
+                throw std::runtime_error("Prediction max angular speed must be a positive number of rad/s");
+            }
+        }
+
+        if (args.count("smoothing") > 0) {
+            inParams.smoothing = args["smoothing"].as<bool>();
+        }
+
+        if (args.count("smoothing-params") > 0) {
+            inParams.smoothingDefault = parseSmoothingSpec(args["smoothing-params"].as<std::string>(), false);
+        }
+
+        if (args.count("smoothing-tags") > 0) {
+            std::stringstream ss(args["smoothing-tags"].as<std::string>());
+            std::string spec{};
+            while (std::getline(ss, spec, ',')) {
+                inParams.smoothingTags.push_back(parseSmoothingSpec(spec, true));
+            }
+        }
+
+        if (args.count("delta") > 0) {
+            inParams.delta = args["delta"].as<bool>();
+        }
+
+        if (args.count("delta-position") > 0) {
+            inParams.deltaPosition = args["delta-position"].as<float>();
+        }
+
+        if (args.count("delta-rotation") > 0) {
+            inParams.deltaRotation = args["delta-rotation"].as<float>();
+        }
+
+        if (args.count("keyframe-interval") > 0) {
+            inParams.keyframeInterval = args["keyframe-interval"].as<std::int32_t>();
+            if (inParams.keyframeInterval < 1) {
+                throw std::runtime_error("Keyframe interval must be at least 1 millisecond");
+            }
+        }
+
+        if (args.count("adaptive-rate") > 0) {
+            inParams.adaptiveRate = args["adaptive-rate"].as<bool>();
+        }
+
+        if (args.count("adaptive-rate-max-interval") > 0) {
+            inParams.adaptiveRateMaxInterval = args["adaptive-rate-max-interval"].as<std::int32_t>();
+            if (inParams.adaptiveRateMaxInterval < 1 || inParams.adaptiveRateMaxInterval > 10000) {
+                throw std::runtime_error("Adaptive rate max interval must be 1 to 10000 milliseconds");
+            }
+        }
+
+        if (args.count("adaptive-rate-speed") > 0) {
+            inParams.adaptiveRateSpeed = args["adaptive-rate-speed"].as<float>();
+            if (false == (inParams.adaptiveRateSpeed > 0.0f)) {
+                throw std::runtime_error("Adaptive rate speed must be positive");
+            }
+        }
+
+        if (args.count("adaptive-rate-angular-speed") > 0) {
+            inParams.adaptiveRateAngularSpeed = args["adaptive-rate-angular-speed"].as<float>();
+            if (false == (inParams.adaptiveRateAngularSpeed > 0.0f)) {
+                throw std::runtime_error("Adaptive rate angular speed must be positive");
+            }
+        }
+
+        if (args.count("adaptive-rate-decay") > 0) {
+            inParams.adaptiveRateDecay = args["adaptive-rate-decay"].as<std::int32_t>();
+            if (inParams.adaptiveRateDecay < 1) {
+                throw std::runtime_error("Adaptive rate decay must be at least 1 millisecond");
+            }
         }
 
         if (args.count("identifier") > 0) {
             inParams.identifier = args["identifier"].as<std::string>();
+            inParams.hasIdentifier = true;
         }
 
         if ( args.count("gpio") > 0) {
@@ -256,6 +673,77 @@ private:
 
             inParams.gpioPinsDefaultState = parseGpioParameter(pins);
         }
+
+        if (args.count("log-level") > 0) {
+            std::string level = args["log-level"].as<std::string>();
+            if (false == parseLogLevel(level, inParams.logLevel)) {
+                throw std::runtime_error("Could not parse log level: " + level);
+            }
+        }
+
+        if (args.count("log-rate") > 0) {
+            inParams.logRate = args["log-rate"].as<std::uint32_t>();
+        }
+
+        if (args.count("telemetry") > 0) {
+            inParams.telemetryFile = args["telemetry"].as<std::string>();
+        }
+
+        if (args.count("telemetry-interval") > 0) {
+            inParams.telemetryInterval = args["telemetry-interval"].as<std::int32_t>();
+            if (inParams.telemetryInterval < 1) {
+                throw std::runtime_error("Telemetry interval must be at least 1 millisecond");
+            }
+        }
+
+        if (args.count("record") > 0) {
+            inParams.recordFile = args["record"].as<std::string>();
+        }
+
+        if (args.count("replay") > 0) {
+            inParams.replayFile = args["replay"].as<std::string>();
+        }
+
+        if (args.count("replay-speed") > 0) {
+            inParams.replaySpeed = args["replay-speed"].as<double>();
+        }
+
+        if (args.count("replay-loop") > 0) {
+            inParams.replayLoop = args["replay-loop"].as<bool>();
+        }
+
+        if (args.count("environment-cache") > 0) {
+            inParams.environmentCacheSize = args["environment-cache"].as<std::size_t>();
+            if (0 == inParams.environmentCacheSize) {
+                throw std::runtime_error("Environment cache must hold at least 1 environment");
+            }
+        }
+
+        if (args.count("ready-file") > 0) {
+            inParams.readyFile = args["ready-file"].as<std::string>();
+        }
+
+        if (args.count("control-socket") > 0) {
+            inParams.controlSocket = args["control-socket"].as<std::string>();
+            if (true == inParams.controlSocket.empty()) {
+                throw std::runtime_error("Control socket path must not be empty");
+            }
+        }
+
+        if (args.count("shm") > 0) {
+            inParams.sharedPoses = args["shm"].as<std::string>();
+            if (true == inParams.sharedPoses.empty() || '/' != inParams.sharedPoses.front()
+                    || std::string::npos != inParams.sharedPoses.find('/', 1)) {
+                throw std::runtime_error("Shared memory name must start with / and contain no other /");
+            }
+        }
+
+        if (args.count("gpio-keyframe") > 0) {
+            inParams.gpioKeyframeInterval = args["gpio-keyframe"].as<std::int32_t>();
+            if (inParams.gpioKeyframeInterval < 0) {
+                throw std::runtime_error("GPIO keyframe interval must not be negative");
+            }
+        }
     }
 };
 
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include <Antilatency.Api.h>
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+// Decides whether a pose differs enough from the last published one of the
+// same node to be worth sending: it moved or turned past the thresholds or
+// its error state changed. Every keyframe interval all poses are published,
+// so receivers that joined late or lost packets catch up.
+class PoseDeltaFilter {
+public:
+    PoseDeltaFilter(bool enabled, float positionThresholdMm, float rotationThresholdDeg, std::int32_t keyframeIntervalMs) :
+        _enabled(enabled),
+        _positionThreshold2(positionThresholdMm * positionThresholdMm / 1e6f),
+        // Two unit quaternions are less than angle apart if |dot| > cos(angle / 2)
+        _rotationThresholdCos(std::cos(rotationThresholdDeg * 3.14159265f / 360.0f)),
+        _keyframeIntervalNs(static_cast<std::int64_t>(keyframeIntervalMs) * 1000000)
+    {}
+
+    bool isEnabled() const {
+        return _enabled;
+    }
+
+    // Called once per tick, returns true if the tick publishes a keyframe
+    bool beginTick(std::int64_t nowNs) {
+        _keyframe = false == _enabled || nowNs - _lastKeyframeNs >= _keyframeIntervalNs;
+        if (true == _keyframe) {
+            _lastKeyframeNs = nowNs;
+        }
+        return _keyframe;
+    }
+
+    // A node without a published pose yet has to be published
+    bool shouldPublish(const Antilatency::IpNetwork::StateMessage &pose,
+                       const Antilatency::IpNetwork::StateMessage &published,
+                       bool hasPublished) const {
+        if (true == _keyframe || false == hasPublished || pose.trackerError != published.trackerError) {
+            return true;
+        }
+
+        float dx = pose.positionX - published.positionX;
+        float dy = pose.positionY - published.positionY;
+        float dz = pose.positionZ - published.positionZ;
+        if (dx * dx + dy * dy + dz * dz > _positionThreshold2) {
+            return true;
+        }
+
+        float dot = pose.rotationX * published.rotationX + pose.rotationY * published.rotationY
+                    + pose.rotationZ * published.rotationZ + pose.rotationW * published.rotationW;
+        return std::fabs(dot) < _rotationThresholdCos;
+    }
+
+private:
+    const bool _enabled;
+    const float _positionThreshold2;
+    const float _rotationThresholdCos;
+    const std::int64_t _keyframeIntervalNs;
+    std::int64_t _lastKeyframeNs = 0;
+    bool _keyframe = true;
+};
+
+}
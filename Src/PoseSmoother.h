@@ -0,0 +1,374 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <Antilatency.Api.h>
+
+#include "Parameters.h"
+#include "StateBatch.h"
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+// Four floats processed together: NEON on the Raspberry Pi, SSE2 on x86 and
+// plain scalar code elsewhere. Only the operations the smoother needs.
+struct Float4 {
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    float32x4_t value;
+
+    static Float4 load(const float *data) { return {vld1q_f32(data)}; }
+    static Float4 fill(float scalar) { return {vdupq_n_f32(scalar)}; }
+    void store(float *data) const { vst1q_f32(data, value); }
+
+    friend Float4 operator+(Float4 a, Float4 b) { return {vaddq_f32(a.value, b.value)}; }
+    friend Float4 operator-(Float4 a, Float4 b) { return {vsubq_f32(a.value, b.value)}; }
+    friend Float4 operator*(Float4 a, Float4 b) { return {vmulq_f32(a.value, b.value)}; }
+#if defined(__aarch64__)
+    friend Float4 operator/(Float4 a, Float4 b) { return {vdivq_f32(a.value, b.value)}; }
+    static Float4 sqrt(Float4 a) { return {vsqrtq_f32(a.value)}; }
+#else
+    // ARMv7 NEON has no division or square root, estimates refined by two
+    // Newton-Raphson steps are within a few ulp
+    friend Float4 operator/(Float4 a, Float4 b) {
+        float32x4_t reciprocal = vrecpeq_f32(b.value);
+        reciprocal = vmulq_f32(vrecpsq_f32(b.value, reciprocal), reciprocal);
+        reciprocal = vmulq_f32(vrecpsq_f32(b.value, reciprocal), reciprocal);
+        return {vmulq_f32(a.value, reciprocal)};
+    }
+    static Float4 sqrt(Float4 a) {
+        float32x4_t positive = vmaxq_f32(a.value, vdupq_n_f32(1e-30f));
+        float32x4_t inverse = vrsqrteq_f32(positive);
+        inverse = vmulq_f32(vrsqrtsq_f32(vmulq_f32(positive, inverse), inverse), inverse);
+        inverse = vmulq_f32(vrsqrtsq_f32(vmulq_f32(positive, inverse), inverse), inverse);
+        return {vmulq_f32(positive, inverse)};
+    }
+#endif
+    static Float4 max(Float4 a, Float4 b) { return {vmaxq_f32(a.value, b.value)}; }
+    // Lanes of flags are 1 or 0
+    static Float4 lessThan(Float4 a, Float4 b) {
+        return {vbslq_f32(vcltq_f32(a.value, b.value), vdupq_n_f32(1.0f), vdupq_n_f32(0.0f))};
+    }
+    static Float4 select(Float4 flags, Float4 a, Float4 b) {
+        return {vbslq_f32(vcgtq_f32(flags.value, vdupq_n_f32(0.5f)), a.value, b.value)};
+    }
+#elif defined(__SSE2__)
+    __m128 value;
+
+    static Float4 load(const float *data) { return {_mm_loadu_ps(data)}; }
+    static Float4 fill(float scalar) { return {_mm_set1_ps(scalar)}; }
+    void store(float *data) const { _mm_storeu_ps(data, value); }
+
+    friend Float4 operator+(Float4 a, Float4 b) { return {_mm_add_ps(a.value, b.value)}; }
+    friend Float4 operator-(Float4 a, Float4 b) { return {_mm_sub_ps(a.value, b.value)}; }
+    friend Float4 operator*(Float4 a, Float4 b) { return {_mm_mul_ps(a.value, b.value)}; }
+    friend Float4 operator/(Float4 a, Float4 b) { return {_mm_div_ps(a.value, b.value)}; }
+    static Float4 sqrt(Float4 a) { return {_mm_sqrt_ps(a.value)}; }
+    static Float4 max(Float4 a, Float4 b) { return {_mm_max_ps(a.value, b.value)}; }
+    static Float4 lessThan(Float4 a, Float4 b) {
+        return {_mm_and_ps(_mm_cmplt_ps(a.value, b.value), _mm_set1_ps(1.0f))};
+    }
+    static Float4 select(Float4 flags, Float4 a, Float4 b) {
+        __m128 mask = _mm_cmpgt_ps(flags.value, _mm_set1_ps(0.5f));
+        return {_mm_or_ps(_mm_and_ps(mask, a.value), _mm_andnot_ps(mask, b.value))};
+    }
+#else
+    std::array<float, 4> value;
+
+    static Float4 load(const float *data) { return {{data[0], data[1], data[2], data[3]}}; }
+    static Float4 fill(float scalar) { return {{scalar, scalar, scalar, scalar}}; }
+    void store(float *data) const { std::copy(value.begin(), value.end(), data); }
+
+    template<typename Operation>
+    static Float4 apply(Float4 a, Float4 b, Operation operation) {
+        return {{operation(a.value[0], b.value[0]), operation(a.value[1], b.value[1]),
+                 operation(a.value[2], b.value[2]), operation(a.value[3], b.value[3])}};
+    }
+    friend Float4 operator+(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return x + y; }); }
+    friend Float4 operator-(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return x - y; }); }
+    friend Float4 operator*(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return x * y; }); }
+    friend Float4 operator/(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return x / y; }); }
+    static Float4 sqrt(Float4 a) { return apply(a, a, [](float x, float) { return std::sqrt(x); }); }
+    static Float4 max(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return std::max(x, y); }); }
+    static Float4 lessThan(Float4 a, Float4 b) {
+        return apply(a, b, [](float x, float y) { return x < y ? 1.0f : 0.0f; });
+    }
+    static Float4 select(Float4 flags, Float4 a, Float4 b) {
+        Float4 result = b;
+        for (std::size_t lane = 0; lane < 4; lane++) {
+            if (flags.value[lane] > 0.5f) {
+                result.value[lane] = a.value[lane];
+            }
+        }
+        return result;
+    }
+#endif
+};
+
+// One-Euro filter (Casiez et al.) for the pose of every tracking node,
+// applied to the sample before motion prediction. The cutoff frequency
+// grows with the filtered speed: a still tracker is smoothed hard, a moving
+// one follows with little lag. Positions are filtered per axis with the
+// cutoff taken from the speed in m/s. Rotations are blended towards the new
+// sample by the same rule, the speed being the angular one in rad/s; the
+// blend is a normalized lerp, which matches slerp closely for the small
+// steps between two samples and vectorizes.
+//
+// The state of all nodes is kept as structure of arrays, indexed like the
+// tracking node list, so update() filters four nodes per instruction.
+// updateScalar() is the same computation one node at a time, kept as a
+// reference for the benchmark.
+class PoseSmoother {
+public:
+    // The slots are processed four at a time
+    static constexpr std::size_t Capacity = (MaxTrackingNodes + 3) / 4 * 4;
+
+    PoseSmoother() {
+        for (std::size_t index = 0; index < Capacity; index++) {
+            setParameters(index, SmoothingSpec{});
+            _rotationW[index] = 1.0f;
+            // Keeps the lanes without input free of NaN
+            _interval[index] = 1.0f;
+        }
+    }
+
+    void setParameters(std::size_t index, const SmoothingSpec &spec) {
+        _minCutoff[index] = spec.minCutoff;
+        _beta[index] = spec.beta;
+        _derivativeCutoff[index] = spec.derivativeCutoff;
+    }
+
+    // The next input of the slot passes unfiltered and starts it again
+    void reset(std::size_t index) {
+        _first[index] = 1.0f;
+        _active[index] = 0.0f;
+        _lastTimestampNs[index] = 0;
+    }
+
+    // Input of the slot for the next update(), slots without one keep their
+    // state and output
+    void setInput(std::size_t index, const Antilatency::Math::floatP3Q &pose, std::int64_t timestampNs) {
+        _inputX[index] = pose.position.x;
+        _inputY[index] = pose.position.y;
+        _inputZ[index] = pose.position.z;
+        _inputRotationX[index] = pose.rotation.x;
+        _inputRotationY[index] = pose.rotation.y;
+        _inputRotationZ[index] = pose.rotation.z;
+        _inputRotationW[index] = pose.rotation.w;
+
+        std::int64_t elapsedNs = timestampNs - _lastTimestampNs[index];
+        // A gap this long means the node was not filtered meanwhile
+        if (0 == _lastTimestampNs[index] || elapsedNs > MaxGapNs) {
+            _first[index] = 1.0f;
+        }
+        _interval[index] = static_cast<float>(std::max<std::int64_t>(elapsedNs, MinIntervalNs)) * 1e-9f;
+        _lastTimestampNs[index] = timestampNs;
+        _active[index] = 1.0f;
+    }
+
+    void update(std::size_t count) {
+        count = std::min(count, Capacity);
+        const Float4 one = Float4::fill(1.0f);
+        const Float4 zero = Float4::fill(0.0f);
+        for (std::size_t index = 0; index < count; index += 4) {
+            Float4 active = Float4::load(&_active[index]);
+            Float4 first = Float4::load(&_first[index]);
+            Float4 interval = Float4::load(&_interval[index]);
+            Float4 derivativeAlpha = alpha(Float4::load(&_derivativeCutoff[index]), interval);
+            Float4 minCutoff = Float4::load(&_minCutoff[index]);
+            Float4 beta = Float4::load(&_beta[index]);
+
+            // Position
+            Float4 x = Float4::load(&_x[index]);
+            Float4 y = Float4::load(&_y[index]);
+            Float4 z = Float4::load(&_z[index]);
+            Float4 inputX = Float4::load(&_inputX[index]);
+            Float4 inputY = Float4::load(&_inputY[index]);
+            Float4 inputZ = Float4::load(&_inputZ[index]);
+            Float4 velocityX = Float4::load(&_velocityX[index]);
+            Float4 velocityY = Float4::load(&_velocityY[index]);
+            Float4 velocityZ = Float4::load(&_velocityZ[index]);
+            velocityX = Float4::select(first, zero, velocityX + derivativeAlpha * ((inputX - x) / interval - velocityX));
+            velocityY = Float4::select(first, zero, velocityY + derivativeAlpha * ((inputY - y) / interval - velocityY));
+            velocityZ = Float4::select(first, zero, velocityZ + derivativeAlpha * ((inputZ - z) / interval - velocityZ));
+            Float4 speed = Float4::sqrt(velocityX * velocityX + velocityY * velocityY + velocityZ * velocityZ);
+            Float4 positionAlpha = Float4::select(first, one, alpha(minCutoff + beta * speed, interval));
+
+            store(active, x + positionAlpha * (inputX - x), x, &_x[index]);
+            store(active, y + positionAlpha * (inputY - y), y, &_y[index]);
+            store(active, z + positionAlpha * (inputZ - z), z, &_z[index]);
+            store(active, velocityX, Float4::load(&_velocityX[index]), &_velocityX[index]);
+            store(active, velocityY, Float4::load(&_velocityY[index]), &_velocityY[index]);
+            store(active, velocityZ, Float4::load(&_velocityZ[index]), &_velocityZ[index]);
+
+            // Rotation, the input is taken on the hemisphere of the state
+            Float4 rotationX = Float4::load(&_rotationX[index]);
+            Float4 rotationY = Float4::load(&_rotationY[index]);
+            Float4 rotationZ = Float4::load(&_rotationZ[index]);
+            Float4 rotationW = Float4::load(&_rotationW[index]);
+            Float4 inputRotationX = Float4::load(&_inputRotationX[index]);
+            Float4 inputRotationY = Float4::load(&_inputRotationY[index]);
+            Float4 inputRotationZ = Float4::load(&_inputRotationZ[index]);
+            Float4 inputRotationW = Float4::load(&_inputRotationW[index]);
+            Float4 dot = rotationX * inputRotationX + rotationY * inputRotationY
+                         + rotationZ * inputRotationZ + rotationW * inputRotationW;
+            Float4 sign = one - Float4::fill(2.0f) * Float4::lessThan(dot, zero);
+            inputRotationX = inputRotationX * sign;
+            inputRotationY = inputRotationY * sign;
+            inputRotationZ = inputRotationZ * sign;
+            inputRotationW = inputRotationW * sign;
+            dot = dot * sign;
+            // 2 * sin(angle / 2), the rotation angle for small steps
+            Float4 angle = Float4::fill(2.0f) * Float4::sqrt(Float4::max(one - dot * dot, zero));
+            Float4 angularSpeed = Float4::load(&_angularSpeed[index]);
+            angularSpeed = Float4::select(first, zero, angularSpeed + derivativeAlpha * (angle / interval - angularSpeed));
+            Float4 rotationAlpha = Float4::select(first, one, alpha(minCutoff + beta * angularSpeed, interval));
+
+            Float4 blendX = rotationX + rotationAlpha * (inputRotationX - rotationX);
+            Float4 blendY = rotationY + rotationAlpha * (inputRotationY - rotationY);
+            Float4 blendZ = rotationZ + rotationAlpha * (inputRotationZ - rotationZ);
+            Float4 blendW = rotationW + rotationAlpha * (inputRotationW - rotationW);
+            Float4 norm = Float4::sqrt(blendX * blendX + blendY * blendY + blendZ * blendZ + blendW * blendW);
+            norm = Float4::max(norm, Float4::fill(1e-12f));
+            store(active, blendX / norm, rotationX, &_rotationX[index]);
+            store(active, blendY / norm, rotationY, &_rotationY[index]);
+            store(active, blendZ / norm, rotationZ, &_rotationZ[index]);
+            store(active, blendW / norm, rotationW, &_rotationW[index]);
+            store(active, angularSpeed, Float4::load(&_angularSpeed[index]), &_angularSpeed[index]);
+
+            store(active, zero, first, &_first[index]);
+            zero.store(&_active[index]);
+        }
+    }
+
+    void updateScalar(std::size_t count) {
+        count = std::min(count, Capacity);
+        for (std::size_t index = 0; index < count; index++) {
+            if (_active[index] < 0.5f) {
+                continue;
+            }
+            bool first = _first[index] > 0.5f;
+            float interval = _interval[index];
+            float derivativeAlpha = alpha(_derivativeCutoff[index], interval);
+
+            float inputX = _inputX[index];
+            float inputY = _inputY[index];
+            float inputZ = _inputZ[index];
+            float velocityX = first ? 0.0f : _velocityX[index] + derivativeAlpha * ((inputX - _x[index]) / interval - _velocityX[index]);
+            float velocityY = first ? 0.0f : _velocityY[index] + derivativeAlpha * ((inputY - _y[index]) / interval - _velocityY[index]);
+            float velocityZ = first ? 0.0f : _velocityZ[index] + derivativeAlpha * ((inputZ - _z[index]) / interval - _velocityZ[index]);
+            float speed = std::sqrt(velocityX * velocityX + velocityY * velocityY + velocityZ * velocityZ);
+            float positionAlpha = first ? 1.0f : alpha(_minCutoff[index] + _beta[index] * speed, interval);
+            _x[index] = _x[index] + positionAlpha * (inputX - _x[index]);
+            _y[index] = _y[index] + positionAlpha * (inputY - _y[index]);
+            _z[index] = _z[index] + positionAlpha * (inputZ - _z[index]);
+            _velocityX[index] = velocityX;
+            _velocityY[index] = velocityY;
+            _velocityZ[index] = velocityZ;
+
+            float rotationX = _rotationX[index];
+            float rotationY = _rotationY[index];
+            float rotationZ = _rotationZ[index];
+            float rotationW = _rotationW[index];
+            float dot = rotationX * _inputRotationX[index] + rotationY * _inputRotationY[index]
+                        + rotationZ * _inputRotationZ[index] + rotationW * _inputRotationW[index];
+            float sign = dot < 0.0f ? -1.0f : 1.0f;
+            float inputRotationX = _inputRotationX[index] * sign;
+            float inputRotationY = _inputRotationY[index] * sign;
+            float inputRotationZ = _inputRotationZ[index] * sign;
+            float inputRotationW = _inputRotationW[index] * sign;
+            dot = dot * sign;
+            float angle = 2.0f * std::sqrt(std::max(1.0f - dot * dot, 0.0f));
+            float angularSpeed = first ? 0.0f : _angularSpeed[index] + derivativeAlpha * (angle / interval - _angularSpeed[index]);
+            float rotationAlpha = first ? 1.0f : alpha(_minCutoff[index] + _beta[index] * angularSpeed, interval);
+
+            float blendX = rotationX + rotationAlpha * (inputRotationX - rotationX);
+            float blendY = rotationY + rotationAlpha * (inputRotationY - rotationY);
+            float blendZ = rotationZ + rotationAlpha * (inputRotationZ - rotationZ);
+            float blendW = rotationW + rotationAlpha * (inputRotationW - rotationW);
+            float norm = std::max(std::sqrt(blendX * blendX + blendY * blendY + blendZ * blendZ + blendW * blendW), 1e-12f);
+            _rotationX[index] = blendX / norm;
+            _rotationY[index] = blendY / norm;
+            _rotationZ[index] = blendZ / norm;
+            _rotationW[index] = blendW / norm;
+            _angularSpeed[index] = angularSpeed;
+
+            _first[index] = 0.0f;
+            _active[index] = 0.0f;
+        }
+    }
+
+    Antilatency::Math::floatP3Q getPose(std::size_t index) const {
+        Antilatency::Math::floatP3Q pose{};
+        pose.position.x = _x[index];
+        pose.position.y = _y[index];
+        pose.position.z = _z[index];
+        pose.rotation.x = _rotationX[index];
+        pose.rotation.y = _rotationY[index];
+        pose.rotation.z = _rotationZ[index];
+        pose.rotation.w = _rotationW[index];
+        return pose;
+    }
+
+private:
+    using Lanes = std::array<float, Capacity>;
+
+    static constexpr std::int64_t MinIntervalNs = 100000;
+    static constexpr std::int64_t MaxGapNs = 1000000000;
+    static constexpr float TwoPi = 6.28318530718f;
+
+    // Smoothing factor of an exponential filter with the cutoff frequency
+    // over the interval: 1 / (1 + tau / interval), tau = 1 / (2 pi cutoff)
+    static Float4 alpha(Float4 cutoff, Float4 interval) {
+        Float4 rate = Float4::fill(TwoPi) * cutoff * interval;
+        return rate / (rate + Float4::fill(1.0f));
+    }
+
+    static float alpha(float cutoff, float interval) {
+        float rate = TwoPi * cutoff * interval;
+        return rate / (rate + 1.0f);
+    }
+
+    static void store(Float4 active, Float4 updated, Float4 previous, float *data) {
+        Float4::select(active, updated, previous).store(data);
+    }
+
+    Lanes _minCutoff{};
+    Lanes _beta{};
+    Lanes _derivativeCutoff{};
+
+    Lanes _active{};
+    Lanes _first{};
+    Lanes _interval{};
+    std::array<std::int64_t, Capacity> _lastTimestampNs{};
+
+    Lanes _inputX{};
+    Lanes _inputY{};
+    Lanes _inputZ{};
+    Lanes _inputRotationX{};
+    Lanes _inputRotationY{};
+    Lanes _inputRotationZ{};
+    Lanes _inputRotationW{};
+
+    Lanes _x{};
+    Lanes _y{};
+    Lanes _z{};
+    Lanes _velocityX{};
+    Lanes _velocityY{};
+    Lanes _velocityZ{};
+    Lanes _rotationX{};
+    Lanes _rotationY{};
+    Lanes _rotationZ{};
+    Lanes _rotationW{};
+    Lanes _angularSpeed{};
+};
+
+}
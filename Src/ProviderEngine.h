@@ -0,0 +1,696 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Antilatency.Api.h>
+
+#include "AdaptiveSendRate.h"
+#include "AllocationCounter.h"
+#include "Backend.h"
+#include "CommandChannel.h"
+#include "ConfigWatcher.h"
+#include "EnvironmentCache.h"
+#include "Log.h"
+#include "MotionPredictor.h"
+#include "Parameters.h"
+#include "PoseDeltaFilter.h"
+#include "PoseSmoother.h"
+#include "Realtime.h"
+#include "SamplingPool.h"
+#include "SharedPosePublisher.h"
+#include "StateBatch.h"
+#include "StateSender.h"
+#include "Startup.h"
+#include "Telemetry.h"
+#include "TickScheduler.h"
+#include "TrackingNodes.h"
+#include "TrackingSupervisor.h"
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+// The provider loop: on every tick applies the commands queued by the
+// command channel and a reloaded configuration file, samples GPIO,
+// follows environment and device network changes, samples every tracking
+// node and publishes the batch to the sender. It only talks to the
+// interfaces from Backend.h, so it runs the same against the SDK and
+// against fakes.
+class ProviderEngine {
+public:
+    ProviderEngine(Parameters &params,
+                   TrackingBackend &backend,
+                   NetworkSink &sink,
+                   GpioSource &gpioSource,
+                   StateSender &stateSender,
+                   Telemetry &telemetry) :
+        _params(params),
+        _backend(backend),
+        _sink(sink),
+        _gpioSource(gpioSource),
+        _stateSender(stateSender),
+        _telemetry(telemetry),
+        _reconciler(backend, sink, params.verbose),
+        _supervisor(backend, params.restartBackoff, params.restartBackoffMax, params.verbose),
+        _tickScheduler(params.waitTime, params.overrunPolicy),
+        _predictor(params.predictionHorizon, params.predictionMaxSpeed, params.predictionMaxAngularSpeed),
+        _deltaFilter(params.delta, params.deltaPosition, params.deltaRotation, params.keyframeInterval),
+        _sendRate(params.adaptiveRate,
+                  params.waitTime,
+                  params.adaptiveRateMaxInterval,
+                  params.adaptiveRateSpeed,
+                  params.adaptiveRateAngularSpeed,
+                  params.adaptiveRateDecay),
+        _samplingPool(params.samplingThreads),
+        _environmentLoader(backend),
+        _commandChannel(sink, stateSender, telemetry, params.controlSocket, params.verbose)
+    {
+        _trackingNodes.reserve(MaxTrackingNodes);
+        _smoothedNodes.fill(Antilatency::DeviceNetwork::NodeHandle::Null);
+        updateSamplesPerPacket();
+    }
+
+    ProviderEngine(const ProviderEngine &) = delete;
+    ProviderEngine &operator=(const ProviderEngine &) = delete;
+
+    // Called at startup only
+    void attachStartup(Startup &startup) {
+        _startup = &startup;
+    }
+
+    // Called at startup only
+    void attachSharedPoses(SharedPosePublisher &sharedPoses) {
+        _sharedPoses = &sharedPoses;
+    }
+
+    // Called at startup only
+    void attachConfigWatcher(ConfigWatcher &configWatcher) {
+        _configWatcher = &configWatcher;
+    }
+
+    // Ticks until stop() is called, with --realtime on the calling thread
+    // switched to real-time scheduling first
+    void run() {
+        if (true == _params.realtime) {
+            Realtime::enable(_params);
+        }
+        while (true == _running.load(std::memory_order_relaxed)) {
+            std::int64_t lateness = _tickScheduler.waitNextTick();
+            std::int64_t tickStartNs = TickScheduler::now();
+            tick(lateness);
+            // Also after ticks that stopped early, e.g. on an invalid environment
+            if (nullptr != _startup && false == _startup->isComplete()) {
+                bool hasPose = std::any_of(_batch.poses.begin(), _batch.poses.begin() + _batch.poseCount,
+                                           [](const Antilatency::IpNetwork::StateMessage &pose) {
+                                               return Antilatency::IpNetwork::ErrorType::None == pose.trackerError;
+                                           });
+                _startup->onTick(tickStartNs, hasPose);
+            }
+            if (true == _jitterReportRequested.exchange(false, std::memory_order_relaxed)) {
+                printMessage(getJitterReport(), true);
+            }
+        }
+    }
+
+    // Safe to call from a signal handler
+    void stop() {
+        _running.store(false, std::memory_order_relaxed);
+    }
+
+    // Safe to call from a signal handler, the report is logged after the
+    // current tick
+    void requestJitterReport() {
+        _jitterReportRequested.store(true, std::memory_order_relaxed);
+    }
+
+    std::string getJitterReport() const {
+        return Realtime::jitterReport(_telemetry.getHistogram(Stage::Lateness), _tickScheduler.getStatistics());
+    }
+
+    const TickScheduler &getTickScheduler() const {
+        return _tickScheduler;
+    }
+
+    const TrackingSupervisor &getSupervisor() const {
+        return _supervisor;
+    }
+
+    std::uint64_t getSuppressedSamples() const {
+        return _suppressedSamples;
+    }
+
+    // Heap allocations of steady state ticks, only counted with
+    // ANTILATENCY_COUNT_ALLOCATIONS
+    std::uint64_t getSteadyStateAllocations() const {
+        return _steadyStateAllocations;
+    }
+
+private:
+    void tick(std::int64_t lateness) {
+        std::int64_t tickStartNs = TickScheduler::now();
+        _telemetry.record(Stage::Lateness, lateness);
+        std::uint64_t allocations = AllocationCounter::get();
+        // Commands, environment, topology and task changes are allowed to allocate
+        bool steadyTick = true;
+
+        {
+            // Validated by the command channel, all commands queued since the
+            // last tick take effect together before anything is sampled
+            Telemetry::StageTimer timer(_telemetry, Stage::Commands);
+            while (true == _commandChannel.pop(_control)) {
+                steadyTick = false;
+                std::string answer = applyCommand(_control);
+                printMessage(commandToString(_control.type), _params.verbose);
+                _commandChannel.acknowledge(_control, answer);
+            }
+            if (nullptr != _configWatcher && true == _configWatcher->poll(_reload)) {
+                steadyTick = false;
+                applyReload(_reload);
+            }
+        }
+
+        _batch.timestampNs = TickScheduler::now();
+        _batch.latenessNs = lateness;
+        _batch.poseCount = 0;
+        {
+            Telemetry::StageTimer timer(_telemetry, Stage::Gpio);
+            _batch.hasGpio = _gpioSource.sample(_batch.timestampNs, _batch.gpioMask);
+            _batch.gpioEdgeNs = _gpioSource.getLastEdgeTimestamp();
+        }
+        const auto &ipNetworkClock = _commandChannel.getIpNetworkClock();
+        _batch.hasClockOffset = ipNetworkClock.hasEstimate();
+        _batch.clockOffsetNs = ipNetworkClock.getOffsetNs();
+
+        if (_prevEnvCode != _params.environmentCode && _failedEnvCode != _params.environmentCode) {
+            steadyTick = false;
+            if (true == _prevEnvCode.empty()) {
+                // Nothing tracks before the first environment, so there is no
+                // point in waiting for it off the tick thread
+                if (false == setFirstEnvironment()) {
+                    return;
+                }
+            } else {
+                switchEnvironment();
+            }
+        }
+
+        if (_prevUpdateId != _backend.getUpdateId()) {
+            steadyTick = false;
+            std::uint32_t updateId = _backend.getUpdateId();
+            ReconcileResult result{};
+            {
+                Telemetry::StageTimer timer(_telemetry, Stage::Reconcile);
+                result = _reconciler.reconcile(_trackingNodes);
+            }
+            updateEnabledNodes();
+            updateSmoothedNodes();
+
+            printMessage("Tracking nodes kept: " + std::to_string(result.kept)
+                             + ", added: " + std::to_string(result.added)
+                             + ", retired: " + std::to_string(result.retired),
+                         _params.verbose);
+            if (result.dropped != _droppedNodes) {
+                _droppedNodes = result.dropped;
+                if (0 != _droppedNodes) {
+                    std::string message = "Too many tracking nodes, " + std::to_string(_droppedNodes)
+                                          + " past " + std::to_string(MaxTrackingNodes) + " are not tracked";
+                    printError(message, true);
+                    _stateSender.postMessage(message);
+                }
+            }
+
+            if (true == _trackingNodes.empty()) {
+                printError(errorToString(Antilatency::IpNetwork::ErrorType::TrackingNodeNotFound), _params.verbose);
+            } else {
+                _prevUpdateId = updateId;
+            }
+        }
+
+        _deltaFilter.beginTick(_batch.timestampNs);
+        if (nullptr != _sharedPoses) {
+            _sharedPoses->beginFrame(_batch.timestampNs);
+        }
+        std::size_t nodeCount = _trackingNodes.size();
+        for (std::size_t index = 0; index < nodeCount; index++) {
+            _events[index] = supervise(_trackingNodes[index]);
+        }
+        _samplingPool.sample(_trackingNodes, nodeCount);
+        if (true == _params.smoothing) {
+            smooth(nodeCount);
+        }
+        for (std::size_t index = 0; index < nodeCount; index++) {
+            if (false == _trackingNodes[index].enabled) {
+                continue;
+            }
+            steadyTick = gather(index, _events[index], _samplingPool.getSample(index)) && steadyTick;
+        }
+
+        if (nullptr != _sharedPoses) {
+            _sharedPoses->endFrame(_gpioSource, _batch.hasClockOffset, _batch.clockOffsetNs);
+        }
+
+        _batch.trackingNodeNotFound = _trackingNodes.empty();
+        _batch.setupGpioFailed = false == _gpioSource.isReady();
+        _samplesInPacket++;
+        _batch.endsPacket = _samplesInPacket >= _samplesPerPacket;
+        if (true == _batch.endsPacket) {
+            _samplesInPacket = 0;
+        }
+
+        _stateSender.publish(_batch);
+
+        _telemetry.record(Stage::Tick, TickScheduler::now() - tickStartNs);
+        const auto &tickStatistics = _tickScheduler.getStatistics();
+        const auto &supervisorStatistics = _supervisor.getStatistics();
+        _telemetry.setCounter(Counter::Ticks, tickStatistics.ticks);
+        _telemetry.setCounter(Counter::Overruns, tickStatistics.overruns);
+        _telemetry.setCounter(Counter::SkippedTicks, tickStatistics.skippedTicks);
+        _telemetry.setCounter(Counter::Restarts, supervisorStatistics.restarts);
+        _telemetry.setCounter(Counter::TaskFailures, supervisorStatistics.failures);
+        _telemetry.setCounter(Counter::SendFailures, _stateSender.getSendFailures());
+        _telemetry.setCounter(Counter::DroppedBatches, _stateSender.getDropped());
+        _telemetry.setCounter(Counter::CoalescedBatches, _stateSender.getCoalesced());
+        _telemetry.setCounter(Counter::SentPackets, _stateSender.getSentPackets());
+        _telemetry.setCounter(Counter::PackedSamples, _stateSender.getPackedSamples());
+        _telemetry.setCounter(Counter::SuppressedSamples, _suppressedSamples);
+
+        if (AllocationCounter::enabled()) {
+            allocations = AllocationCounter::get() - allocations;
+            if (steadyTick && 0 != allocations) {
+                _steadyStateAllocations += allocations;
+                printError("Steady state tick allocated " + std::to_string(allocations) + " times", true);
+            }
+        }
+    }
+
+    // Returns the answer of a query
+    std::string applyCommand(const Control &control) {
+        switch (control.type) {
+        case CommandType::SetEnvironmentCode:
+            _params.environmentCode = control.getText();
+            // A code that failed before is tried again when sent again
+            _failedEnvCode.clear();
+            break;
+        case CommandType::SetSendingRate:
+            _params.waitTime = control.number;
+            _tickScheduler.setPeriod(_params.waitTime);
+            _sendRate.setIntervals(_params.waitTime, _params.adaptiveRateMaxInterval);
+            updateSamplesPerPacket();
+            break;
+        case CommandType::SetPredictionHorizon:
+            _params.predictionHorizon = control.number;
+            _predictor.setHorizon(_params.predictionHorizon);
+            break;
+        case CommandType::SetNodeEnabled: {
+            std::string tag = control.getText();
+            auto disabled = std::find(_disabledTags.begin(), _disabledTags.end(), tag);
+            if (0 == control.number && disabled == _disabledTags.end()) {
+                _disabledTags.push_back(tag);
+            } else if (0 != control.number && disabled != _disabledTags.end()) {
+                _disabledTags.erase(disabled);
+            }
+            updateEnabledNodes();
+            break;
+        }
+        case CommandType::SetLogLevel:
+            Logger::instance().setLevel(static_cast<LogLevel>(control.number));
+            break;
+        case CommandType::SetAdaptiveRate:
+            _params.adaptiveRate = 0 != control.number;
+            if (true == _params.adaptiveRate) {
+                _params.adaptiveRateMaxInterval = control.number;
+            }
+            _sendRate.setEnabled(_params.adaptiveRate);
+            _sendRate.setIntervals(_params.waitTime, _params.adaptiveRateMaxInterval);
+            break;
+        case CommandType::GetSendRates:
+            return getSendRates();
+        case CommandType::TelemetrySnapshot:
+            // Answered by the command channel itself
+            break;
+        }
+        return {};
+    }
+
+    // Only the parts that changed in the file are applied, the same way the
+    // commands apply them
+    void applyReload(const ConfigReload &reload) {
+        const Parameters &next = *reload.params;
+        std::string applied{};
+        if (0 != (reload.changes & ConfigReload::Environment)) {
+            _params.environmentCode = next.environmentCode;
+            _failedEnvCode.clear();
+            applied += " environment";
+        }
+        if (0 != (reload.changes & ConfigReload::Rates)) {
+            _params.waitTime = next.waitTime;
+            _params.sendInterval = next.sendInterval;
+            _params.predictionHorizon = next.predictionHorizon;
+            _params.adaptiveRate = next.adaptiveRate;
+            _params.adaptiveRateMaxInterval = next.adaptiveRateMaxInterval;
+            _tickScheduler.setPeriod(_params.waitTime);
+            _predictor.setHorizon(_params.predictionHorizon);
+            _sendRate.setEnabled(_params.adaptiveRate);
+            _sendRate.setIntervals(_params.waitTime, _params.adaptiveRateMaxInterval);
+            updateSamplesPerPacket();
+            applied += " rates";
+        }
+        if (0 != (reload.changes & ConfigReload::Identifier)) {
+            _params.identifier = next.identifier;
+            Logger::instance().setIdentifier(_params.identifier);
+            applied += " identifier";
+        }
+        if (0 != (reload.changes & ConfigReload::Logging)) {
+            _params.logLevel = next.logLevel;
+            _params.logRate = next.logRate;
+            Logger::instance().setLevel(_params.logLevel);
+            Logger::instance().setRateLimit(_params.logRate);
+            applied += " logging";
+        }
+        if (0 != (reload.changes & ConfigReload::GpioDefaults)) {
+            _params.gpioPinsDefaultState = next.gpioPinsDefaultState;
+            if (true == _gpioSource.configure(_params.gpioPinsDefaultState)) {
+                applied += " gpio";
+            } else {
+                printError("Could not set GPIO pins, GPIO is not set up", true);
+            }
+        }
+        // Prepared by the watcher, only the primary receiver changes
+        if (0 != (reload.changes & ConfigReload::Receiver) && true == _sink.switchReceiver()) {
+            _params.receiver = next.receiver;
+            _params.port = next.port;
+            applied += " primary receiver";
+        }
+
+        if (true == applied.empty()) {
+            return;
+        }
+        printMessage("Configuration reloaded:" + applied, _params.verbose);
+        _stateSender.postMessage("Configuration reloaded:" + applied);
+    }
+
+    // Tags and rates of the enabled nodes, e.g. "T1 100.0 Hz, T2 10.0 Hz"
+    std::string getSendRates() const {
+        if (false == _sendRate.isEnabled()) {
+            return "off";
+        }
+        std::stringstream ss{};
+        ss << std::fixed << std::setprecision(1);
+        for (const auto &trackingNode : _trackingNodes) {
+            if (false == trackingNode.enabled) {
+                continue;
+            }
+            ss << (0 == ss.tellp() ? "" : ", ") << trackingNode.tagName << " " << trackingNode.sendRate.rateHz << " Hz";
+        }
+        return ss.str();
+    }
+
+    // Disabled tags also apply to nodes plugged in later
+    void updateEnabledNodes() {
+        for (auto &trackingNode : _trackingNodes) {
+            bool enabled = _disabledTags.end()
+                           == std::find(_disabledTags.begin(), _disabledTags.end(), trackingNode.tagName);
+            if (false == enabled && true == trackingNode.enabled) {
+                printMessage("Tracking node disabled: " + trackingNode.tagName, _params.verbose);
+            }
+            trackingNode.enabled = enabled;
+        }
+    }
+
+    bool setFirstEnvironment() {
+        try {
+            Telemetry::StageTimer timer(_telemetry, Stage::Environment);
+            bool created = _backend.setEnvironment(_params.environmentCode);
+
+            // Running tasks are bound to the previous environment
+            _trackingNodes.clear();
+            _smoothedNodes.fill(Antilatency::DeviceNetwork::NodeHandle::Null);
+            _prevUpdateId--;
+
+            if (false == created) {
+                printError("Could not create environment: " + _params.environmentCode, _params.verbose);
+                _stateSender.postMessage("Could not create environment: " + _params.environmentCode);
+                return false;
+            }
+        } catch (const std::exception &ex) {
+            _stateSender.postMessage(Antilatency::enumToString(Antilatency::IpNetwork::ErrorType::AltEnvironmentArbitrary2D));
+            printError(Antilatency::enumToString(Antilatency::IpNetwork::ErrorType::AltEnvironmentArbitrary2D)
+                           + ": " + ex.what(),
+                       _params.verbose);
+            return false;
+        }
+
+        _prevEnvCode = _params.environmentCode;
+
+        printMessage("New environment: " + _params.environmentCode, _params.verbose);
+        _stateSender.postMessage("New environment: " + _params.environmentCode);
+        return true;
+    }
+
+    // The nodes keep tracking in the previous environment until the new one
+    // is prepared off the tick thread. Then all of them switch on the same
+    // tick: the nodes, their tags and health stay, only the tasks are started
+    // again, as a task is bound to the environment it was started in.
+    void switchEnvironment() {
+        auto status = _environmentLoader.poll(_params.environmentCode);
+        if (EnvironmentStatus::Pending == status) {
+            return;
+        }
+
+        bool created = false;
+        std::string error{};
+        if (EnvironmentStatus::Ready == status) {
+            try {
+                Telemetry::StageTimer timer(_telemetry, Stage::Environment);
+                created = _backend.setEnvironment(_params.environmentCode);
+            } catch (const std::exception &ex) {
+                status = EnvironmentStatus::Invalid;
+                error = ex.what();
+            }
+        } else if (EnvironmentStatus::Invalid == status) {
+            error = _environmentLoader.getError();
+        }
+
+        // The receiver gets the error type only, as before, the log also
+        // tells why the code was rejected
+        if (EnvironmentStatus::Invalid == status) {
+            _failedEnvCode = _params.environmentCode;
+            _stateSender.postMessage(Antilatency::enumToString(Antilatency::IpNetwork::ErrorType::AltEnvironmentArbitrary2D));
+            printError(Antilatency::enumToString(Antilatency::IpNetwork::ErrorType::AltEnvironmentArbitrary2D)
+                           + (true == error.empty() ? "" : ": " + error),
+                       _params.verbose);
+            return;
+        }
+        if (false == created) {
+            _failedEnvCode = _params.environmentCode;
+            printError("Could not create environment: " + _params.environmentCode, _params.verbose);
+            _stateSender.postMessage("Could not create environment: " + _params.environmentCode);
+            return;
+        }
+
+        for (std::size_t index = 0; index < _trackingNodes.size(); index++) {
+            _supervisor.rebind(_trackingNodes[index]);
+            // Poses of the new environment are not continued from the old ones
+            _smoother.reset(index);
+        }
+        _prevEnvCode = _params.environmentCode;
+
+        printMessage("New environment: " + _params.environmentCode, _params.verbose);
+        _stateSender.postMessage("New environment: " + _params.environmentCode);
+    }
+
+    // Starts and restarts the task of the node before it is sampled, stops
+    // the task of a disabled node
+    SupervisorEvent supervise(TrackingNode &trackingNode) {
+        if (false == trackingNode.enabled) {
+            // Started again right away once enabled
+            _supervisor.rebind(trackingNode);
+            return SupervisorEvent::None;
+        }
+        auto event = _supervisor.supervise(trackingNode, _batch.timestampNs);
+        if (SupervisorEvent::Started == event) {
+            printMessage("Started tracking task", _params.verbose);
+            _stateSender.postMessage("Started tracking task");
+        } else if (SupervisorEvent::StartFailed == event) {
+            printNodeError(trackingNode.node, Antilatency::IpNetwork::ErrorType::TrakingCotaskConstructFailed);
+        } else if (SupervisorEvent::TaskFinished == event) {
+            printNodeError(trackingNode.node, Antilatency::IpNetwork::ErrorType::TrackingTaskRestartMessage);
+        }
+        return event;
+    }
+
+    // Filters the samples of all nodes in one pass, a node that did not
+    // deliver a pose starts over with its next one
+    void smooth(std::size_t nodeCount) {
+        Telemetry::StageTimer timer(_telemetry, Stage::Smoothing);
+        for (std::size_t index = 0; index < nodeCount; index++) {
+            const auto &sample = _samplingPool.getSample(index);
+            if (true == _trackingNodes[index].enabled && true == sample.sampled && false == sample.failed) {
+                _smoother.setInput(index, sample.state.pose, sample.timestampNs);
+            } else {
+                _smoother.reset(index);
+            }
+        }
+        _smoother.update(nodeCount);
+    }
+
+    // Filter state is kept per list position, so a position taken by another
+    // node starts over; the settings follow the tag
+    void updateSmoothedNodes() {
+        for (std::size_t index = 0; index < _trackingNodes.size(); index++) {
+            const auto &trackingNode = _trackingNodes[index];
+            auto spec = std::find_if(_params.smoothingTags.begin(), _params.smoothingTags.end(),
+                                     [&trackingNode](const SmoothingSpec &spec) {
+                                         return spec.tag == trackingNode.tagName;
+                                     });
+            _smoother.setParameters(index, spec != _params.smoothingTags.end() ? *spec : _params.smoothingDefault);
+            if (_smoothedNodes[index] != trackingNode.node) {
+                _smoothedNodes[index] = trackingNode.node;
+                _smoother.reset(index);
+            }
+        }
+    }
+
+    // Adds the node pose sampled by the pool to the batch, returns false if
+    // the task state changed
+    bool gather(std::size_t index, SupervisorEvent event, const NodeSample &sample) {
+        TrackingNode &trackingNode = _trackingNodes[index];
+        Antilatency::IpNetwork::StateMessage poseSample{};
+
+        poseSample.trackerError = Antilatency::IpNetwork::ErrorType::None;
+        poseSample.rawTag = trackingNode.tag;
+
+        if (false == sample.sampled) {
+            poseSample.trackerError = SupervisorEvent::StartFailed == event
+                                          ? Antilatency::IpNetwork::ErrorType::TrakingCotaskConstructFailed
+                                          : Antilatency::IpNetwork::ErrorType::TrackingTaskRestartMessage;
+            addPose(trackingNode, poseSample, _batch.timestampNs);
+            return SupervisorEvent::None == event;
+        }
+
+        if (true == sample.failed) {
+            poseSample.trackerError = Antilatency::IpNetwork::ErrorType::GetTrackerStateFailed;
+            addPose(trackingNode, poseSample, _batch.timestampNs);
+            return SupervisorEvent::None == event;
+        }
+
+        _telemetry.record(Stage::GetState, sample.getStateNs);
+
+        Antilatency::Alt::Tracking::State state = sample.state;
+        if (true == _params.smoothing) {
+            state.pose = _smoother.getPose(index);
+        }
+        auto pose = _predictor.predict(state);
+        poseSample.positionX = pose.position.x;
+        poseSample.positionY = pose.position.y;
+        poseSample.positionZ = pose.position.z;
+        poseSample.rotationX = pose.rotation.x;
+        poseSample.rotationY = pose.rotation.y;
+        poseSample.rotationZ = pose.rotation.z;
+        poseSample.rotationW = pose.rotation.w;
+
+        if (true == _sendRate.isEnabled()) {
+            _sendRate.update(trackingNode.sendRate, sample.state, sample.timestampNs);
+        }
+
+        if (_supervisor.onSampled(trackingNode, _batch.timestampNs) && _params.verbose) {
+            auto &statistics = _supervisor.getStatistics();
+            printMessage(
+                std::to_string(static_cast<uint32_t>(trackingNode.node))
+                    + ": recovered in " + std::to_string(trackingNode.health.lastRecoveryNs / 1000000)
+                    + " ms after " + std::to_string(trackingNode.health.restarts)
+                    + " restarts, total restarts: " + std::to_string(statistics.restarts),
+                _params.verbose
+                );
+        }
+
+        addPose(trackingNode, poseSample, sample.timestampNs);
+        return SupervisorEvent::None == event;
+    }
+
+    void addPose(TrackingNode &trackingNode,
+                 const Antilatency::IpNetwork::StateMessage &poseSample,
+                 std::int64_t sampleTimeNs) {
+        if (nullptr != _sharedPoses) {
+            _sharedPoses->addPose(trackingNode.tagName, poseSample, sampleTimeNs);
+        }
+        // A changed error state is sent right away whatever the send rate
+        bool errorChanged = false == trackingNode.hasPublished
+                            || poseSample.trackerError != trackingNode.published.trackerError;
+        if (false == errorChanged && false == _sendRate.isDue(trackingNode.sendRate, _batch.timestampNs)) {
+            _suppressedSamples++;
+            return;
+        }
+        if (false == _deltaFilter.shouldPublish(poseSample, trackingNode.published, trackingNode.hasPublished)) {
+            _suppressedSamples++;
+            return;
+        }
+        trackingNode.published = poseSample;
+        trackingNode.hasPublished = true;
+        _sendRate.onSent(trackingNode.sendRate, _batch.timestampNs);
+        _batch.sendRatesHz[_batch.poseCount] = true == _sendRate.isEnabled() ? trackingNode.sendRate.rateHz : 0.0f;
+        _batch.sampleTimesNs[_batch.poseCount] = sampleTimeNs;
+        _batch.poses[_batch.poseCount++] = poseSample;
+    }
+
+    void updateSamplesPerPacket() {
+        _samplesPerPacket = 1;
+        if (_params.sendInterval > 0 && _params.waitTime > 0) {
+            _samplesPerPacket = static_cast<std::uint32_t>(std::max(_params.sendInterval / _params.waitTime, 1));
+        }
+    }
+
+    void printNodeError(Antilatency::DeviceNetwork::NodeHandle node, Antilatency::IpNetwork::ErrorType errorType) {
+        if (true == _params.verbose) {
+            printError(std::to_string(static_cast<uint32_t>(node)) + ": " + errorToString(errorType), _params.verbose);
+        }
+    }
+
+    Parameters &_params;
+    TrackingBackend &_backend;
+    NetworkSink &_sink;
+    GpioSource &_gpioSource;
+    StateSender &_stateSender;
+    Telemetry &_telemetry;
+    SharedPosePublisher *_sharedPoses = nullptr;
+    ConfigWatcher *_configWatcher = nullptr;
+    Startup *_startup = nullptr;
+
+    TrackingNodeReconciler _reconciler;
+    TrackingSupervisor _supervisor;
+    TickScheduler _tickScheduler;
+    MotionPredictor _predictor;
+    PoseDeltaFilter _deltaFilter;
+    AdaptiveSendRate _sendRate;
+    SamplingPool _samplingPool;
+    PoseSmoother _smoother{};
+    std::array<Antilatency::DeviceNetwork::NodeHandle, MaxTrackingNodes> _smoothedNodes{};
+    std::array<SupervisorEvent, MaxTrackingNodes> _events{};
+    std::uint64_t _suppressedSamples = 0;
+    std::uint64_t _steadyStateAllocations = 0;
+    std::atomic<bool> _running{true};
+    std::atomic<bool> _jitterReportRequested{false};
+
+    EnvironmentLoader _environmentLoader;
+    std::string _prevEnvCode{};
+    // Not retried until the code is sent again
+    std::string _failedEnvCode{};
+    std::uint32_t _prevUpdateId = 0;
+    std::vector<TrackingNode> _trackingNodes{};
+    // Nodes left out by the last reconcile, reported when it changes
+    std::size_t _droppedNodes = 0;
+    CommandChannel _commandChannel;
+    Control _control{};
+    ConfigReload _reload{};
+    std::vector<std::string> _disabledTags{};
+    StateBatch _batch{};
+    std::uint32_t _samplesPerPacket = 1;
+    std::uint32_t _samplesInPacket = 0;
+};
+
+}
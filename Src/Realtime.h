@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Parameters.h"
+#include "Telemetry.h"
+#include "TickScheduler.h"
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+// Puts the calling thread, the tick thread, under SCHED_FIFO on its own CPU
+// and keeps the process memory resident, so page faults and ordinary
+// processes cannot delay a tick. Every step that fails for lack of
+// permissions (CAP_SYS_NICE, CAP_IPC_LOCK or a too small RLIMIT_MEMLOCK) is
+// logged and skipped, the provider keeps running without it. Threads started
+// earlier keep the default scheduling, so the sender, logger and telemetry
+// threads never compete with the tick thread.
+class Realtime {
+public:
+    // Returns true if every step succeeded
+    static bool enable(const Parameters &params) {
+        bool complete = true;
+
+        // Freed heap stays mapped and locked instead of going back to the kernel
+        mallopt(M_TRIM_THRESHOLD, -1);
+        mallopt(M_MMAP_MAX, 0);
+        prefaultStack();
+
+        // Also faults in every buffer allocated so far
+        if (0 != mlockall(MCL_CURRENT | MCL_FUTURE)) {
+            printError(std::string("Realtime: mlockall failed: ") + std::strerror(errno), true);
+            complete = false;
+        }
+
+        std::int32_t cpu = params.realtimeCpu;
+        if (cpu < 0) {
+            cpu = std::max(static_cast<std::int32_t>(sysconf(_SC_NPROCESSORS_ONLN)) - 1, 0);
+        }
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(cpu, &cpuSet);
+        int result = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+        if (0 != result) {
+            printError("Realtime: could not pin the tick thread to CPU " + std::to_string(cpu) + ": "
+                           + std::strerror(result),
+                       true);
+            complete = false;
+        }
+
+        sched_param schedParam{};
+        schedParam.sched_priority = params.realtimePriority;
+        result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &schedParam);
+        if (0 != result) {
+            printError("Realtime: could not set SCHED_FIFO priority " + std::to_string(params.realtimePriority)
+                           + ": " + std::strerror(result),
+                       true);
+            complete = false;
+        }
+
+        if (true == complete) {
+            printMessage("Realtime: tick thread runs SCHED_FIFO " + std::to_string(params.realtimePriority)
+                             + " on CPU " + std::to_string(cpu) + " with memory locked",
+                         true);
+        }
+        return complete;
+    }
+
+    // Wake-up lateness of the tick thread since the start
+    static std::string jitterReport(const LatencyHistogram &lateness, const TickStatistics &tickStatistics) {
+        std::ostringstream report{};
+        report << "Wake-up jitter over " << lateness.getCount() << " ticks, us: p50 "
+               << lateness.getPercentile(0.5) / 1000
+               << ", p90 " << lateness.getPercentile(0.9) / 1000
+               << ", p99 " << lateness.getPercentile(0.99) / 1000
+               << ", p99.9 " << lateness.getPercentile(0.999) / 1000
+               << ", max " << lateness.getMax() / 1000
+               << ", overruns: " << tickStatistics.overruns;
+        return report.str();
+    }
+
+private:
+    static void prefaultStack() {
+        constexpr std::size_t StackPrefaultSize = 256 * 1024;
+        unsigned char stack[StackPrefaultSize];
+        std::memset(stack, 0, sizeof(stack));
+        // Keeps the compiler from dropping the writes
+        asm volatile("" : : "r"(stack) : "memory");
+    }
+};
+
+}
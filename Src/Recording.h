@@ -0,0 +1,340 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <Antilatency.Api.h>
+
+#include "Log.h"
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+// Recording file layout, little endian:
+//   header:  8 byte magic "ALTREC01"
+//   record:  u32 payload length, u32 CRC-32 of the payload, payload
+//   payload: i64 timestamp ns, u16 pose count, u8 has GPIO, u8 reserved,
+//            u32 GPIO mask, u16 error length, poses, error text
+//   pose:    raw tag, u32 tracker error, 7 x f32 position and rotation
+// A record is only valid if it is complete and its checksum matches, so a
+// file cut by power loss is read up to the last whole record.
+namespace Recording {
+    constexpr std::array<char, 8> Magic{'A', 'L', 'T', 'R', 'E', 'C', '0', '1'};
+    constexpr std::size_t RecordHeaderSize = 8;
+    constexpr std::size_t PayloadHeaderSize = 18;
+    constexpr std::size_t PoseSize = sizeof(Antilatency::IpNetwork::RawString32) + 4 + 7 * 4;
+
+    inline std::uint32_t crc32(const std::uint8_t *data, std::size_t size) {
+        static const std::array<std::uint32_t, 256> table = [] {
+            std::array<std::uint32_t, 256> result{};
+            for (std::uint32_t index = 0; index < result.size(); index++) {
+                std::uint32_t value = index;
+                for (int bit = 0; bit < 8; bit++) {
+                    value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+                }
+                result[index] = value;
+            }
+            return result;
+        }();
+
+        std::uint32_t crc = 0xFFFFFFFFu;
+        for (std::size_t index = 0; index < size; index++) {
+            crc = table[(crc ^ data[index]) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    template<typename T>
+    void put(std::vector<std::uint8_t> &buffer, const T &value) {
+        const auto *bytes = reinterpret_cast<const std::uint8_t *>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    template<typename T>
+    T get(const std::uint8_t *&data) {
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        data += sizeof(T);
+        return value;
+    }
+
+    // Offset of the end of the last valid record, 0 if the header is invalid
+    inline std::size_t findValidEnd(const std::uint8_t *data, std::size_t size) {
+        if (size < Magic.size() || 0 != std::memcmp(data, Magic.data(), Magic.size())) {
+            return 0;
+        }
+
+        std::size_t offset = Magic.size();
+        while (offset + RecordHeaderSize <= size) {
+            const std::uint8_t *cursor = data + offset;
+            auto length = get<std::uint32_t>(cursor);
+            auto crc = get<std::uint32_t>(cursor);
+            if (length < PayloadHeaderSize
+                    || length > size - offset - RecordHeaderSize
+                    || crc != crc32(cursor, length)) {
+                break;
+            }
+            offset += RecordHeaderSize + length;
+        }
+        return offset;
+    }
+}
+
+struct RecordedState {
+    std::int64_t timestampNs = 0;
+    std::vector<Antilatency::IpNetwork::StateMessage> poses{};
+    bool hasGpio = false;
+    std::uint32_t gpioMask = 0;
+    std::string error{};
+};
+
+// Appends everything the provider sends to a recording file. Records are
+// written with a single write() each and the file is synced once a second
+// from a background thread.
+class RecordWriter {
+public:
+    RecordWriter() = default;
+    RecordWriter(const RecordWriter &) = delete;
+    RecordWriter &operator=(const RecordWriter &) = delete;
+
+    ~RecordWriter() {
+        close();
+    }
+
+    // Appends to an existing recording. Any other non-empty file is left as
+    // it is and an error returned, so a wrong path never wipes a file.
+    bool open(const std::string &filePath, std::string &error) {
+        _fd = ::open(filePath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (_fd < 0) {
+            error = std::strerror(errno);
+            return false;
+        }
+
+        // Cut a torn record left by a crash, so new records stay reachable
+        struct stat fileStat{};
+        fstat(_fd, &fileStat);
+        std::size_t size = static_cast<std::size_t>(fileStat.st_size);
+        std::size_t validEnd = 0;
+        if (size > 0) {
+            void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, _fd, 0);
+            if (MAP_FAILED == data) {
+                error = std::strerror(errno);
+                close();
+                return false;
+            }
+            const auto *bytes = static_cast<const std::uint8_t *>(data);
+            // A crash may also have torn the header of a new recording
+            bool isRecording = 0 == std::memcmp(bytes, Recording::Magic.data(), std::min(size, Recording::Magic.size()));
+            validEnd = Recording::findValidEnd(bytes, size);
+            munmap(data, size);
+            if (false == isRecording) {
+                error = "not a recording";
+                close();
+                return false;
+            }
+        }
+
+        if (0 == validEnd) {
+            if (0 != ftruncate(_fd, 0)
+                    || Recording::Magic.size() != static_cast<std::size_t>(pwrite(_fd, Recording::Magic.data(), Recording::Magic.size(), 0))) {
+                error = std::strerror(errno);
+                close();
+                return false;
+            }
+            validEnd = Recording::Magic.size();
+        } else if (validEnd != size && 0 != ftruncate(_fd, static_cast<off_t>(validEnd))) {
+            error = std::strerror(errno);
+            close();
+            return false;
+        }
+        lseek(_fd, static_cast<off_t>(validEnd), SEEK_SET);
+
+        _buffer.reserve(4096);
+        _running = true;
+        _syncThread = std::thread(&RecordWriter::sync, this);
+        return true;
+    }
+
+    bool isOpen() const {
+        return _fd >= 0;
+    }
+
+    void close() {
+        if (_syncThread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _running = false;
+            }
+            _wakeUp.notify_one();
+            _syncThread.join();
+        }
+        if (_fd >= 0) {
+            fdatasync(_fd);
+            ::close(_fd);
+            _fd = -1;
+        }
+    }
+
+    void append(std::int64_t timestampNs,
+                const std::vector<Antilatency::IpNetwork::StateMessage> &poses,
+                bool hasGpio,
+                std::uint32_t gpioMask,
+                const std::string &error) {
+        if (_fd < 0) {
+            return;
+        }
+
+        _buffer.clear();
+        Recording::put(_buffer, std::uint32_t(0));
+        Recording::put(_buffer, std::uint32_t(0));
+        Recording::put(_buffer, timestampNs);
+        Recording::put(_buffer, static_cast<std::uint16_t>(poses.size()));
+        Recording::put(_buffer, static_cast<std::uint8_t>(hasGpio ? 1 : 0));
+        Recording::put(_buffer, std::uint8_t(0));
+        Recording::put(_buffer, gpioMask);
+        Recording::put(_buffer, static_cast<std::uint16_t>(std::min<std::size_t>(error.size(), 0xFFFF)));
+        for (const auto &pose : poses) {
+            Recording::put(_buffer, pose.rawTag);
+            Recording::put(_buffer, static_cast<std::uint32_t>(pose.trackerError));
+            for (float value : {pose.positionX, pose.positionY, pose.positionZ,
+                                pose.rotationX, pose.rotationY, pose.rotationZ, pose.rotationW}) {
+                Recording::put(_buffer, value);
+            }
+        }
+        _buffer.insert(_buffer.end(), error.begin(), error.begin() + std::min<std::size_t>(error.size(), 0xFFFF));
+
+        std::uint32_t length = static_cast<std::uint32_t>(_buffer.size() - Recording::RecordHeaderSize);
+        std::uint32_t crc = Recording::crc32(_buffer.data() + Recording::RecordHeaderSize, length);
+        std::memcpy(_buffer.data(), &length, sizeof(length));
+        std::memcpy(_buffer.data() + sizeof(length), &crc, sizeof(crc));
+
+        if (static_cast<ssize_t>(_buffer.size()) != write(_fd, _buffer.data(), _buffer.size())) {
+            _failures.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    std::uint64_t getFailures() const {
+        return _failures.load(std::memory_order_relaxed);
+    }
+
+private:
+    void sync() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true == _running) {
+            _wakeUp.wait_for(lock, std::chrono::seconds(1));
+            fdatasync(_fd);
+        }
+    }
+
+    int _fd = -1;
+    std::vector<std::uint8_t> _buffer{};
+    std::atomic<std::uint64_t> _failures{0};
+
+    std::mutex _mutex{};
+    std::condition_variable _wakeUp{};
+    bool _running = false;
+    std::thread _syncThread{};
+};
+
+// Reads a recording through a read-only memory mapping
+class RecordReader {
+public:
+    RecordReader() = default;
+    RecordReader(const RecordReader &) = delete;
+    RecordReader &operator=(const RecordReader &) = delete;
+
+    ~RecordReader() {
+        if (nullptr != _data) {
+            munmap(const_cast<std::uint8_t *>(_data), _size);
+        }
+    }
+
+    bool open(const std::string &filePath) {
+        int fd = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat fileStat{};
+        fstat(fd, &fileStat);
+        _size = static_cast<std::size_t>(fileStat.st_size);
+        void *data = _size > 0 ? mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if (MAP_FAILED == data) {
+            return false;
+        }
+
+        _data = static_cast<const std::uint8_t *>(data);
+        madvise(const_cast<std::uint8_t *>(_data), _size, MADV_SEQUENTIAL);
+        _end = Recording::findValidEnd(_data, _size);
+        rewind();
+        return 0 != _end;
+    }
+
+    // Bytes after the last valid record, e.g. a record torn by power loss
+    std::size_t getInvalidTail() const {
+        return _size - _end;
+    }
+
+    void rewind() {
+        _offset = Recording::Magic.size();
+    }
+
+    bool next(RecordedState &state) {
+        if (_offset + Recording::RecordHeaderSize > _end) {
+            return false;
+        }
+
+        const std::uint8_t *cursor = _data + _offset;
+        auto length = Recording::get<std::uint32_t>(cursor);
+        Recording::get<std::uint32_t>(cursor);
+        _offset += Recording::RecordHeaderSize + length;
+
+        state.timestampNs = Recording::get<std::int64_t>(cursor);
+        auto poseCount = Recording::get<std::uint16_t>(cursor);
+        state.hasGpio = 0 != Recording::get<std::uint8_t>(cursor);
+        Recording::get<std::uint8_t>(cursor);
+        state.gpioMask = Recording::get<std::uint32_t>(cursor);
+        auto errorLength = Recording::get<std::uint16_t>(cursor);
+
+        if (Recording::PayloadHeaderSize + poseCount * Recording::PoseSize + errorLength != length) {
+            return false;
+        }
+
+        state.poses.resize(poseCount);
+        for (auto &pose : state.poses) {
+            pose.rawTag = Recording::get<Antilatency::IpNetwork::RawString32>(cursor);
+            pose.trackerError = static_cast<Antilatency::IpNetwork::ErrorType>(Recording::get<std::uint32_t>(cursor));
+            pose.positionX = Recording::get<float>(cursor);
+            pose.positionY = Recording::get<float>(cursor);
+            pose.positionZ = Recording::get<float>(cursor);
+            pose.rotationX = Recording::get<float>(cursor);
+            pose.rotationY = Recording::get<float>(cursor);
+            pose.rotationZ = Recording::get<float>(cursor);
+            pose.rotationW = Recording::get<float>(cursor);
+        }
+        state.error.assign(reinterpret_cast<const char *>(cursor), errorLength);
+        return true;
+    }
+
+private:
+    const std::uint8_t *_data = nullptr;
+    std::size_t _size = 0;
+    std::size_t _end = 0;
+    std::size_t _offset = 0;
+};
+
+}
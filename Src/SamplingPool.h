@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <Antilatency.Api.h>
+
+#include "StateBatch.h"
+#include "TickScheduler.h"
+#include "TrackingNodes.h"
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+struct NodeSample {
+    Antilatency::Alt::Tracking::State state{};
+    std::int64_t getStateNs = 0;
+    // Middle of the getState call
+    std::int64_t timestampNs = 0;
+    // The node has a task and getState was called
+    bool sampled = false;
+    // getState threw
+    bool failed = false;
+};
+
+// Calls getState of the tracking nodes on a fixed set of threads. The node at
+// index i is always sampled by thread i % threadCount, the tick thread being
+// thread 0, so a node stays on the same thread while the node list does not
+// change. Results land in a preallocated array in node order, so gathering
+// them on the tick thread gives the same batch whatever the thread count.
+// Everything else about a node, restarts, logging and the delta filter, stays
+// on the tick thread.
+class SamplingPool {
+public:
+    // 0 and 1 sample on the tick thread only
+    explicit SamplingPool(std::uint32_t threadCount) :
+        _threadCount(std::max<std::uint32_t>(threadCount, 1))
+    {
+        for (std::uint32_t worker = 1; worker < _threadCount; worker++) {
+            _workers.emplace_back(&SamplingPool::workerLoop, this, worker);
+        }
+    }
+
+    SamplingPool(const SamplingPool &) = delete;
+    SamplingPool &operator=(const SamplingPool &) = delete;
+
+    ~SamplingPool() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _startCondition.notify_all();
+        for (auto &worker : _workers) {
+            worker.join();
+        }
+    }
+
+    std::uint32_t getThreadCount() const {
+        return _threadCount;
+    }
+
+    // Samples the first count nodes, returns when all of them are done
+    void sample(std::vector<TrackingNode> &trackingNodes, std::size_t count) {
+        _trackingNodes = &trackingNodes;
+        _count = std::min<std::size_t>(count, MaxTrackingNodes);
+        if (1 == _threadCount || _count <= 1) {
+            sampleShare(0, 1);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _pending = _threadCount - 1;
+            _generation++;
+        }
+        _startCondition.notify_all();
+
+        sampleShare(0, _threadCount);
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _doneCondition.wait(lock, [this] { return 0 == _pending; });
+    }
+
+    const NodeSample &getSample(std::size_t index) const {
+        return _samples[index];
+    }
+
+private:
+    void workerLoop(std::uint32_t worker) {
+        std::uint64_t seenGeneration = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _startCondition.wait(lock, [this, seenGeneration] {
+                    return true == _stopping || seenGeneration != _generation;
+                });
+                if (true == _stopping) {
+                    return;
+                }
+                seenGeneration = _generation;
+            }
+
+            sampleShare(worker, _threadCount);
+
+            bool last = false;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                last = 0 == --_pending;
+            }
+            if (true == last) {
+                _doneCondition.notify_one();
+            }
+        }
+    }
+
+    void sampleShare(std::uint32_t worker, std::uint32_t stride) {
+        for (std::size_t index = worker; index < _count; index += stride) {
+            auto &trackingNode = (*_trackingNodes)[index];
+            auto &sample = _samples[index];
+            sample.sampled = trackingNode.trackingCotask != nullptr;
+            sample.failed = false;
+            if (false == sample.sampled) {
+                continue;
+            }
+
+            try {
+                std::int64_t startNs = TickScheduler::now();
+                sample.state = trackingNode.trackingCotask->getState(
+                            Antilatency::Alt::Tracking::Constants::DefaultAngularVelocityAvgTime
+                            );
+                sample.getStateNs = TickScheduler::now() - startNs;
+                sample.timestampNs = startNs + sample.getStateNs / 2;
+            } catch (const std::exception &) {
+                sample.failed = true;
+            }
+        }
+    }
+
+    const std::uint32_t _threadCount;
+    std::vector<std::thread> _workers{};
+    std::array<NodeSample, MaxTrackingNodes> _samples{};
+
+    // Set by the tick thread before a generation starts, read by the workers
+    // after they see it under the mutex
+    std::vector<TrackingNode> *_trackingNodes = nullptr;
+    std::size_t _count = 0;
+
+    std::mutex _mutex{};
+    std::condition_variable _startCondition{};
+    std::condition_variable _doneCondition{};
+    std::uint64_t _generation = 0;
+    std::uint32_t _pending = 0;
+    bool _stopping = false;
+};
+
+}
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <Antilatency.Api.h>
+
+#include "Backend.h"
+#include "EnvironmentCache.h"
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+class SdkTrackingTask : public TrackingTask {
+public:
+    explicit SdkTrackingTask(Antilatency::Alt::Tracking::ITrackingCotask trackingCotask) :
+        _trackingCotask(trackingCotask)
+    {}
+
+    bool isTaskFinished() override {
+        return _trackingCotask.isTaskFinished();
+    }
+
+    Antilatency::Alt::Tracking::State getState(float angularVelocityAvgTime) override {
+        return _trackingCotask.getState(angularVelocityAvgTime);
+    }
+
+private:
+    Antilatency::Alt::Tracking::ITrackingCotask _trackingCotask;
+};
+
+// Trackers attached through Antilatency Device Network and AltTracking
+class SdkTrackingBackend : public TrackingBackend {
+public:
+    SdkTrackingBackend(Antilatency::DeviceNetwork::INetwork deviceNetwork,
+                       Antilatency::Alt::Tracking::ILibrary altTrackingLibrary,
+                       Antilatency::Alt::Tracking::ITrackingCotaskConstructor cotaskConstructor,
+                       std::size_t environmentCacheSize) :
+        _deviceNetwork(deviceNetwork),
+        _altTrackingLibrary(altTrackingLibrary),
+        _cotaskConstructor(cotaskConstructor),
+        _environments(environmentCacheSize)
+    {}
+
+    std::uint32_t getUpdateId() override {
+        return _deviceNetwork.getUpdateId();
+    }
+
+    std::vector<Antilatency::DeviceNetwork::NodeHandle> findSupportedNodes() override {
+        return _cotaskConstructor.findSupportedNodes(_deviceNetwork);
+    }
+
+    Antilatency::DeviceNetwork::NodeStatus nodeGetStatus(Antilatency::DeviceNetwork::NodeHandle node) override {
+        return _deviceNetwork.nodeGetStatus(node);
+    }
+
+    std::string nodeGetParentProperty(Antilatency::DeviceNetwork::NodeHandle node, const std::string &key) override {
+        auto parent = _deviceNetwork.nodeGetParent(node);
+        return _deviceNetwork.nodeGetStringProperty(parent, key);
+    }
+
+    bool prepareEnvironment(const std::string &environmentCode) override {
+        Antilatency::Alt::Tracking::IEnvironment environment{};
+        if (true == _environments.find(environmentCode, environment)) {
+            return true;
+        }
+        environment = _altTrackingLibrary.createEnvironment(environmentCode);
+        if (environment == nullptr) {
+            return false;
+        }
+        _environments.insert(environmentCode, environment);
+        return true;
+    }
+
+    bool setEnvironment(const std::string &environmentCode) override {
+        if (false == prepareEnvironment(environmentCode)) {
+            return false;
+        }
+        return _environments.find(environmentCode, _environment);
+    }
+
+    // Takes an environment created during startup
+    void adoptEnvironment(const std::string &environmentCode, Antilatency::Alt::Tracking::IEnvironment environment) {
+        _environments.insert(environmentCode, environment);
+    }
+
+    std::unique_ptr<TrackingTask> startTask(Antilatency::DeviceNetwork::NodeHandle node) override {
+        auto trackingCotask = _cotaskConstructor.startTask(_deviceNetwork, node, _environment);
+        if (trackingCotask == nullptr) {
+            return nullptr;
+        }
+        return std::make_unique<SdkTrackingTask>(trackingCotask);
+    }
+
+private:
+    Antilatency::DeviceNetwork::INetwork _deviceNetwork;
+    Antilatency::Alt::Tracking::ILibrary _altTrackingLibrary;
+    Antilatency::Alt::Tracking::ITrackingCotaskConstructor _cotaskConstructor;
+    Antilatency::Alt::Tracking::IEnvironment _environment{};
+    EnvironmentCache<Antilatency::Alt::Tracking::IEnvironment> _environments;
+};
+
+// Receiver reached through Antilatency IP Network. The server handle is
+// used by the sender, the command channel and the configuration reload, and
+// the SDK does not say it may be used from several threads, so every call on
+// a server is made under one mutex; a call waits for at most one send or one
+// command fetch. The server of another receiver is created by
+// prepareReceiver without the mutex, as it may take a name lookup, and
+// switchReceiver only swaps it in. Both servers take commands on the same
+// port, so the command channel releases the previous server, which closes
+// its port, before the new one starts listening.
+class SdkNetworkSink : public NetworkSink {
+public:
+    SdkNetworkSink(Antilatency::IpNetwork::ILibrary ainLibrary,
+                   Antilatency::IpNetwork::INetworkServer netServer,
+                   const std::string &id) :
+        _ainLibrary(ainLibrary),
+        _netServer(netServer),
+        _id(id)
+    {}
+
+    void startCommandListening() override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _netServer.startCommandListening();
+        _listening = true;
+    }
+
+    void getCommands(std::vector<Command> &commands) override {
+        commands.clear();
+        std::lock_guard<std::mutex> lock(_mutex);
+        restartCommandListening();
+        auto commandList = _netServer.getCommands();
+        for (std::size_t index = 0; index < commandList.size(); index++) {
+            auto command = commandList.get(index);
+            if (command.key() == Antilatency::IpNetwork::CommandKey::SetEnvinromentCode) {
+                commands.push_back({CommandType::SetEnvironmentCode, command.value()});
+            } else if (command.key() == Antilatency::IpNetwork::CommandKey::SetSendingRate) {
+                commands.push_back({CommandType::SetSendingRate, command.value()});
+            }
+        }
+    }
+
+    void sendStateMessages(const std::vector<Antilatency::IpNetwork::StateMessage> &poses,
+                           const std::vector<Antilatency::IpNetwork::GpioPinState> &gpioState,
+                           const std::string &deviceError,
+                           const PacketTimes &) override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _netServer.sendStateMessages(poses, gpioState, deviceError);
+    }
+
+    Antilatency::IpNetwork::RawString32 getRawTagFromString(const std::string &tag) override {
+        return _ainLibrary.getRawTagFromString(tag);
+    }
+
+    std::string getTagFromRawTag(const Antilatency::IpNetwork::RawString32 &rawTag) override {
+        return _ainLibrary.getTagFromRawTag(rawTag);
+    }
+
+    std::uint64_t getCurrentTime() override {
+        return _ainLibrary.getCurrentTime();
+    }
+
+    void prepareReceiver(const std::string &address, const std::string &port) override {
+        auto netServer = _ainLibrary.getNetworkServer(
+                    _id,
+                    Antilatency::IpNetwork::Constants::DefaultIfaceAddress,
+                    address,
+                    std::stoi(port),
+                    Antilatency::IpNetwork::Constants::DefaultCommandPort
+                    );
+        if (netServer == nullptr) {
+            throw std::runtime_error("Could not create IP Network server for " + address + ":" + port);
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        _preparedServer = netServer;
+    }
+
+    // Commands not fetched from the previous server yet are lost
+    bool switchReceiver() override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_preparedServer == nullptr) {
+            return false;
+        }
+        _retiredServer = _netServer;
+        _netServer = _preparedServer;
+        _preparedServer = {};
+        _restartListening = _listening;
+        return true;
+    }
+
+private:
+    // Command channel side after a switch, called with the mutex locked
+    void restartCommandListening() {
+        if (false == _restartListening) {
+            return;
+        }
+        _restartListening = false;
+        _retiredServer = {};
+        try {
+            _netServer.startCommandListening();
+        } catch (const std::exception &) {
+            // The port of the previous server may take a moment to close,
+            // listening is tried again on the next call
+            _restartListening = true;
+            throw;
+        }
+    }
+
+    Antilatency::IpNetwork::ILibrary _ainLibrary;
+    // Held during every call on a server
+    std::mutex _mutex{};
+    Antilatency::IpNetwork::INetworkServer _netServer;
+    Antilatency::IpNetwork::INetworkServer _preparedServer{};
+    Antilatency::IpNetwork::INetworkServer _retiredServer{};
+    bool _restartListening = false;
+    bool _listening = false;
+    const std::string _id;
+};
+
+}
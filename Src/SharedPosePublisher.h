@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <Antilatency.Api.h>
+
+#include "Backend.h"
+#include "SharedPoses.h"
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+// Writer side of SharedPoses.h. Every tick the engine hands over the pose of
+// every node, before the delta filter and the packet pacing, so local readers
+// always see the newest sample of every node. The frame is built in private
+// memory and copied into the segment under the sequence lock, which keeps the
+// window readers have to retry in short.
+class SharedPosePublisher {
+public:
+    SharedPosePublisher() = default;
+    SharedPosePublisher(const SharedPosePublisher &) = delete;
+    SharedPosePublisher &operator=(const SharedPosePublisher &) = delete;
+
+    ~SharedPosePublisher() {
+        close();
+    }
+
+    // Creates the segment or takes over the one left by a previous run
+    bool open(const std::string &name) {
+        close();
+        int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        if (0 != ftruncate(fd, sizeof(SharedPoses::Segment))) {
+            ::close(fd);
+            return false;
+        }
+        void *data = mmap(nullptr, sizeof(SharedPoses::Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (MAP_FAILED == data) {
+            return false;
+        }
+
+        _segment = static_cast<SharedPoses::Segment *>(data);
+        _name = name;
+
+        // Readers attached to a previous run see the lock drop to 0, which
+        // reads as nothing published yet
+        _segment->lock.store(0, std::memory_order_release);
+        std::memset(&_segment->frame, 0, sizeof(_segment->frame));
+        _segment->segmentSize = sizeof(SharedPoses::Segment);
+        _segment->version = SharedPoses::Version;
+        _segment->magic = SharedPoses::Magic;
+        return true;
+    }
+
+    bool isOpen() const {
+        return nullptr != _segment;
+    }
+
+    void close() {
+        if (nullptr != _segment) {
+            munmap(_segment, sizeof(SharedPoses::Segment));
+            shm_unlink(_name.c_str());
+            _segment = nullptr;
+        }
+    }
+
+    void beginFrame(std::int64_t timestampNs) {
+        _frame.timestampNs = timestampNs;
+        _frame.poseCount = 0;
+    }
+
+    void addPose(const std::string &tag, const Antilatency::IpNetwork::StateMessage &pose, std::int64_t sampleTimeNs) {
+        if (_frame.poseCount == SharedPoses::MaxNodes) {
+            return;
+        }
+        auto &sharedPose = _frame.poses[_frame.poseCount++];
+        std::size_t tagSize = std::min<std::size_t>(tag.size(), SharedPoses::TagSize);
+        std::memcpy(sharedPose.tag, tag.data(), tagSize);
+        std::memset(sharedPose.tag + tagSize, 0, SharedPoses::TagSize - tagSize);
+        sharedPose.sampleTimeNs = sampleTimeNs;
+        sharedPose.error = static_cast<std::uint32_t>(pose.trackerError);
+        sharedPose.position[0] = pose.positionX;
+        sharedPose.position[1] = pose.positionY;
+        sharedPose.position[2] = pose.positionZ;
+        sharedPose.rotation[0] = pose.rotationX;
+        sharedPose.rotation[1] = pose.rotationY;
+        sharedPose.rotation[2] = pose.rotationZ;
+        sharedPose.rotation[3] = pose.rotationW;
+    }
+
+    void endFrame(const GpioSource &gpioSource, bool hasClockOffset, std::int64_t clockOffsetNs) {
+        if (nullptr == _segment) {
+            return;
+        }
+        _frame.gpioMask = gpioSource.getMask();
+        for (auto pin : wiringPiPins) {
+            _frame.gpioEdgesNs[pin] = gpioSource.getEdgeTimestamp(pin);
+        }
+        _frame.hasClockOffset = true == hasClockOffset ? 1 : 0;
+        _frame.clockOffsetNs = clockOffsetNs;
+
+        std::uint64_t lock = _segment->lock.load(std::memory_order_relaxed);
+        _frame.sequence = lock / 2 + 1;
+        _segment->lock.store(lock + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&_segment->frame, &_frame, offsetof(SharedPoses::Frame, poses));
+        std::memcpy(_segment->frame.poses, _frame.poses, _frame.poseCount * sizeof(SharedPoses::Pose));
+        _segment->lock.store(lock + 2, std::memory_order_release);
+    }
+
+    std::uint64_t getSequence() const {
+        return _frame.sequence;
+    }
+
+private:
+    SharedPoses::Segment *_segment = nullptr;
+    std::string _name{};
+    SharedPoses::Frame _frame{};
+};
+
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+// Latest poses and GPIO state published by the provider into POSIX shared
+// memory (--shm). Only depends on the standard library, so other programs on
+// the same machine can include this header alone to read the segment:
+//
+//     SharedPoses::Reader reader{};
+//     SharedPoses::Frame frame{};
+//     if (reader.open(SharedPoses::DefaultName) && reader.read(frame)) { ... }
+//
+// The segment holds a single frame guarded by a sequence lock: the provider
+// makes the lock odd while it writes and even again when done, readers copy
+// the frame and retry if the lock changed meanwhile. Reading never blocks the
+// provider, never allocates and never enters the kernel.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Antilatency::IpTrackingDemoProvider::SharedPoses {
+
+constexpr const char *DefaultName = "/antilatency-poses";
+constexpr std::uint32_t Magic = 0x50534C41; // "ALSP"
+constexpr std::uint32_t Version = 2;
+constexpr std::uint32_t MaxNodes = 64;
+constexpr std::uint32_t TagSize = 32;
+constexpr std::uint32_t GpioPins = 32;
+
+struct Pose {
+    // Tracker tag, zero terminated unless it takes all 32 bytes
+    char tag[TagSize];
+    // CLOCK_MONOTONIC time the pose was sampled at, nanoseconds
+    std::int64_t sampleTimeNs;
+    // Antilatency::IpNetwork::ErrorType of the sample, 0 is none
+    std::uint32_t error;
+    float position[3];
+    // x, y, z, w
+    float rotation[4];
+};
+
+struct Frame {
+    // Incremented by every published frame, starts at 1
+    std::uint64_t sequence;
+    // CLOCK_MONOTONIC time the frame was sampled at, nanoseconds
+    std::int64_t timestampNs;
+    // IP Network time of the provider minus CLOCK_MONOTONIC, valid if
+    // hasClockOffset is not 0; adding it maps the timestamps of the frame
+    // into the time the log shows as c_time
+    std::int64_t clockOffsetNs;
+    std::uint32_t hasClockOffset;
+    // Pin states indexed by wiringPi pin number
+    std::uint32_t gpioMask;
+    // CLOCK_MONOTONIC time of the last edge of every pin, 0 if it never changed
+    std::int64_t gpioEdgesNs[GpioPins];
+    std::uint32_t poseCount;
+    Pose poses[MaxNodes];
+};
+
+struct Segment {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t segmentSize;
+    std::uint32_t reserved;
+    alignas(64) std::atomic<std::uint64_t> lock;
+    Frame frame;
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "The lock is shared between processes");
+
+class Reader {
+public:
+    Reader() = default;
+    Reader(const Reader &) = delete;
+    Reader &operator=(const Reader &) = delete;
+
+    ~Reader() {
+        close();
+    }
+
+    bool open(const char *name) {
+        close();
+        int fd = shm_open(name, O_RDONLY, 0);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat segmentStat{};
+        if (0 != fstat(fd, &segmentStat) || static_cast<std::size_t>(segmentStat.st_size) < sizeof(Segment)) {
+            ::close(fd);
+            return false;
+        }
+        void *data = mmap(nullptr, sizeof(Segment), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (MAP_FAILED == data) {
+            return false;
+        }
+
+        _segment = static_cast<const Segment *>(data);
+        if (Magic != _segment->magic || Version != _segment->version || sizeof(Segment) != _segment->segmentSize) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (nullptr != _segment) {
+            munmap(const_cast<Segment *>(_segment), sizeof(Segment));
+            _segment = nullptr;
+        }
+    }
+
+    // Sequence of the latest frame, 0 if nothing was published yet. Cheap
+    // enough to poll for new frames.
+    std::uint64_t getSequence() const {
+        return nullptr != _segment ? _segment->lock.load(std::memory_order_acquire) / 2 : 0;
+    }
+
+    // Copies the latest frame. Returns false if nothing was published yet or
+    // every attempt raced with the provider writing a new frame.
+    bool read(Frame &frame, std::uint32_t attempts = 1000) const {
+        if (nullptr == _segment) {
+            return false;
+        }
+        for (std::uint32_t attempt = 0; attempt < attempts; attempt++) {
+            std::uint64_t lock = _segment->lock.load(std::memory_order_acquire);
+            if (0 == lock) {
+                return false;
+            }
+            if (0 != (lock & 1)) {
+                continue;
+            }
+            // Header first, then only the poses in use
+            std::memcpy(&frame, &_segment->frame, offsetof(Frame, poses));
+            std::uint32_t poseCount = frame.poseCount < MaxNodes ? frame.poseCount : MaxNodes;
+            std::memcpy(frame.poses, _segment->frame.poses, poseCount * sizeof(Pose));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (lock == _segment->lock.load(std::memory_order_relaxed)) {
+                frame.poseCount = poseCount;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    const Segment *_segment = nullptr;
+};
+
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+enum class OverflowPolicy {
+    // A full ring overwrites its oldest unread item
+    DropOldest,
+    // A full ring replaces its newest unread item with the incoming one
+    Coalesce
+};
+
+// Bounded single-producer/single-consumer ring that never blocks the producer.
+// Every slot is guarded by a sequence counter, so the consumer detects and
+// retries reads that raced with the producer overwriting the slot.
+template<typename T>
+class SpscRing {
+    static_assert(std::is_trivially_copyable<T>::value, "SpscRing items are copied as raw bytes");
+public:
+    SpscRing(std::size_t capacity, OverflowPolicy policy) :
+        _capacity(capacity < 2 ? 2 : capacity),
+        _policy(policy),
+        _slots(new Slot[_capacity])
+    {}
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    // Producer side
+    void push(const T &item) {
+        std::uint64_t head = _head.load(std::memory_order_relaxed);
+
+        if (OverflowPolicy::Coalesce == _policy) {
+            std::uint64_t tail = _tail.load(std::memory_order_acquire);
+            if (head - tail >= _capacity) {
+                write(head - 1, item);
+                _coalesced.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        write(head, item);
+        _head.store(head + 1, std::memory_order_release);
+    }
+
+    // Consumer side, returns false if the ring is empty
+    bool pop(T &item) {
+        std::uint64_t tail = _tail.load(std::memory_order_relaxed);
+
+        while (true) {
+            std::uint64_t head = _head.load(std::memory_order_acquire);
+            if (tail == head) {
+                return false;
+            }
+            if (head - tail > _capacity) {
+                _dropped.fetch_add(head - _capacity - tail, std::memory_order_relaxed);
+                tail = head - _capacity;
+            }
+
+            Slot &slot = _slots[tail % _capacity];
+            std::uint64_t version = slot.version.load(std::memory_order_acquire);
+            if (0 != (version & 1)) {
+                continue;
+            }
+            std::uint64_t index = slot.index.load(std::memory_order_relaxed);
+            std::memcpy(static_cast<void *>(&item), &slot.item, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (version != slot.version.load(std::memory_order_relaxed)) {
+                continue;
+            }
+            if (index != tail) {
+                // Overwritten by a newer item, the next head read will skip ahead
+                continue;
+            }
+
+            _tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+    }
+
+    bool empty() const {
+        return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+    }
+
+    // Unread items, at most the capacity once the consumer caught up
+    std::size_t size() const {
+        return static_cast<std::size_t>(_head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire));
+    }
+
+    std::size_t capacity() const {
+        return _capacity;
+    }
+
+    std::uint64_t getDropped() const {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t getCoalesced() const {
+        return _coalesced.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Slot {
+        std::atomic<std::uint64_t> version{0};
+        std::atomic<std::uint64_t> index{~std::uint64_t(0)};
+        T item;
+    };
+
+    void write(std::uint64_t index, const T &item) {
+        Slot &slot = _slots[index % _capacity];
+        std::uint64_t version = slot.version.load(std::memory_order_relaxed);
+        slot.version.store(version + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.index.store(index, std::memory_order_relaxed);
+        std::memcpy(static_cast<void *>(&slot.item), &item, sizeof(T));
+        slot.version.store(version + 2, std::memory_order_release);
+    }
+
+    const std::size_t _capacity;
+    const OverflowPolicy _policy;
+    std::unique_ptr<Slot[]> _slots;
+
+    alignas(64) std::atomic<std::uint64_t> _head{0};
+    alignas(64) std::atomic<std::uint64_t> _tail{0};
+    std::atomic<std::uint64_t> _dropped{0};
+    std::atomic<std::uint64_t> _coalesced{0};
+};
+
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Parameters.h"
+#include "TickScheduler.h"
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+// Tells systemd the service state through $NOTIFY_SOCKET, the protocol of
+// sd_notify(3) without linking libsystemd. Does nothing when the provider is
+// not started by a Type=notify unit.
+inline bool notifySystemd(const std::string &state) {
+    const char *socketPath = std::getenv("NOTIFY_SOCKET");
+    if (nullptr == socketPath || ('/' != socketPath[0] && '@' != socketPath[0])) {
+        return false;
+    }
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::size_t pathSize = std::string(socketPath).size();
+    if (pathSize >= sizeof(address.sun_path)) {
+        return false;
+    }
+    std::copy(socketPath, socketPath + pathSize, address.sun_path);
+    // Abstract socket
+    if ('@' == address.sun_path[0]) {
+        address.sun_path[0] = '\0';
+    }
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    auto sent = sendto(fd, state.data(), state.size(), MSG_NOSIGNAL, reinterpret_cast<const sockaddr *>(&address),
+                       static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + pathSize));
+    close(fd);
+    return sent == static_cast<decltype(sent)>(state.size());
+}
+
+// Startup phases and readiness. Phases may run concurrently, every one is
+// logged with its start and end relative to the start of main(). The
+// provider is ready once the first tick ran: the receivers are reachable and
+// commands are listened to, so systemd and --ready-file are told then. The
+// time to the first pose handed to the sender is logged on its own, it also
+// depends on when the trackers are plugged in.
+class Startup {
+public:
+    explicit Startup(const Parameters &params) :
+        _readyFile(params.readyFile),
+        _startNs(TickScheduler::now())
+    {}
+
+    std::int64_t getStartNs() const {
+        return _startNs;
+    }
+
+    // Records a phase that ran from startNs until now, safe from any thread
+    void record(const std::string &phase, std::int64_t startNs) {
+        std::int64_t endNs = TickScheduler::now();
+        std::lock_guard<std::mutex> lock(_mutex);
+        _phases.push_back(Phase{phase, startNs - _startNs, endNs - _startNs});
+    }
+
+    bool isComplete() const {
+        return true == _ready && true == _posed;
+    }
+
+    // Called by the engine after every tick until isComplete()
+    void onTick(std::int64_t tickStartNs, bool hasPose) {
+        if (false == _ready) {
+            _ready = true;
+            record("first tick", tickStartNs);
+            notifySystemd("READY=1\nSTATUS=Waiting for trackers");
+            if (false == _readyFile.empty()) {
+                writeReadyFile();
+            }
+            printMessage(report(), true);
+        }
+
+        if (false == _posed && true == hasPose) {
+            _posed = true;
+            std::int64_t elapsedMs = (TickScheduler::now() - _startNs) / 1000000;
+            notifySystemd("STATUS=Tracking, first pose after " + std::to_string(elapsedMs) + " ms");
+            printMessage("Startup: first pose after " + std::to_string(elapsedMs) + " ms", true);
+        }
+    }
+
+    std::string report() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::ostringstream stream{};
+        stream << "Startup, ms from start:";
+        for (const auto &phase : _phases) {
+            stream << " " << phase.name << " " << phase.startNs / 1000000 << "-" << phase.endNs / 1000000 << ";";
+        }
+        return stream.str();
+    }
+
+    // The ready file only exists while the provider runs
+    ~Startup() {
+        if (true == _ready && false == _readyFile.empty()) {
+            std::remove(_readyFile.c_str());
+        }
+    }
+
+private:
+    struct Phase {
+        std::string name{};
+        std::int64_t startNs = 0;
+        std::int64_t endNs = 0;
+    };
+
+    void writeReadyFile() {
+        // Written next to the target and renamed, so a watcher never sees it half written
+        std::string temporary = _readyFile + ".tmp";
+        FILE *file = std::fopen(temporary.c_str(), "w");
+        if (nullptr == file) {
+            printError("Could not write ready file " + _readyFile, true);
+            return;
+        }
+        std::fprintf(file, "%d\n", static_cast<int>(getpid()));
+        std::fclose(file);
+        if (0 != std::rename(temporary.c_str(), _readyFile.c_str())) {
+            printError("Could not write ready file " + _readyFile, true);
+        }
+    }
+
+    const std::string _readyFile;
+    const std::int64_t _startNs;
+    mutable std::mutex _mutex{};
+    std::vector<Phase> _phases{};
+    bool _ready = false;
+    bool _posed = false;
+};
+
+}
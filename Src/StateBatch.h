@@ -0,0 +1,40 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <Antilatency.Api.h>
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+constexpr std::size_t MaxTrackingNodes = 64;
+// A packet holding more poses is sent before the next samples are added
+constexpr std::size_t MaxPackedPoses = 4 * MaxTrackingNodes;
+
+// One tick worth of samples, handed from the sampler to the sender by value
+struct StateBatch {
+    std::int64_t timestampNs = 0;
+    std::int64_t latenessNs = 0;
+    bool trackingNodeNotFound = false;
+    bool setupGpioFailed = false;
+    std::uint32_t poseCount = 0;
+    std::array<Antilatency::IpNetwork::StateMessage, MaxTrackingNodes> poses{};
+    // CLOCK_MONOTONIC time of every pose, taken around getState; the tick
+    // time for poses that only carry an error
+    std::array<std::int64_t, MaxTrackingNodes> sampleTimesNs{};
+    // Send rate of the node of every pose with --adaptive-rate, 0 without
+    std::array<float, MaxTrackingNodes> sendRatesHz{};
+    // GPIO state is carried only when it changed or a keyframe is due
+    bool hasGpio = false;
+    std::uint32_t gpioMask = 0;
+    // Time of the latest edge, 0 if no pin changed yet; sent to the
+    // receivers of the compact encoding along with the sample times
+    std::int64_t gpioEdgeNs = 0;
+    // IP Network time minus CLOCK_MONOTONIC, once it is estimated
+    bool hasClockOffset = false;
+    std::int64_t clockOffsetNs = 0;
+    // The sender sends the samples packed so far together with this batch
+    bool endsPacket = true;
+};
+
+}
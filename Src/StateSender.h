@@ -0,0 +1,328 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <Antilatency.Api.h>
+
+#include "Backend.h"
+#include "Log.h"
+#include "Parameters.h"
+#include "Recording.h"
+#include "SpscRing.h"
+#include "StateBatch.h"
+#include "Telemetry.h"
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+// Sender stage of the pipeline: drains batches published by the sampler and
+// forwards them to the network server on its own thread, so a slow or blocked
+// socket never delays the next sample.
+class StateSender {
+public:
+    // GPIO edges are sent at most this often, so a bouncing contact does not
+    // flood the receiver; the state it settles to is sent once the interval
+    // is over
+    static constexpr std::int64_t GpioEdgeIntervalNs = 5 * 1000000;
+
+    StateSender(NetworkSink &sink, const Parameters &params) :
+        _sink(sink),
+        _verbose(params.verbose),
+        _ring(params.queueSize, params.overflowPolicy),
+        _event(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    {
+        _poses.reserve(MaxPackedPoses);
+        _times.sampleTimesNs.reserve(MaxPackedPoses);
+        _messages.reserve(16);
+        _pendingMessages.reserve(16);
+        _gpioState.reserve(wiringPiPins.size());
+    }
+
+    StateSender(const StateSender &) = delete;
+    StateSender &operator=(const StateSender &) = delete;
+
+    ~StateSender() {
+        stop();
+        if (_event >= 0) {
+            close(_event);
+        }
+    }
+
+    // GPIO edges are sent as soon as they happen, without waiting for a tick
+    void attachGpio(const GpioSource &gpioSource) {
+        _gpioSource = &gpioSource;
+    }
+
+    void attachTelemetry(Telemetry &telemetry) {
+        _telemetry = &telemetry;
+    }
+
+    void attachRecorder(RecordWriter &recorder) {
+        _recorder = &recorder;
+    }
+
+    void start() {
+        if (true == _running.exchange(true)) {
+            return;
+        }
+        _thread = std::thread(&StateSender::run, this);
+    }
+
+    void stop() {
+        if (false == _running.exchange(false)) {
+            return;
+        }
+        notify();
+        _thread.join();
+    }
+
+    // Sampler side, never blocks
+    void publish(const StateBatch &batch) {
+        _ring.push(batch);
+        notify();
+    }
+
+    // Status messages are rare, they are queued apart from the pose batches
+    void postMessage(const std::string &message) {
+        {
+            std::lock_guard<std::mutex> lock(_messagesMutex);
+            _messages.push_back(message);
+        }
+        notify();
+    }
+
+    std::uint64_t getDropped() const {
+        return _ring.getDropped();
+    }
+
+    std::uint64_t getCoalesced() const {
+        return _ring.getCoalesced();
+    }
+
+    std::uint64_t getSendFailures() const {
+        return _sendFailures.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t getSentPackets() const {
+        return _sentPackets.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t getPackedSamples() const {
+        return _packedSamplesTotal.load(std::memory_order_relaxed);
+    }
+
+private:
+    void notify() {
+        std::uint64_t value = 1;
+        ssize_t written = write(_event, &value, sizeof(value));
+        (void)written;
+    }
+
+    void run() {
+        std::array<pollfd, 2> events{{
+            {_event, POLLIN, 0},
+            {nullptr != _gpioSource ? _gpioSource->getEventFd() : -1, POLLIN, 0}
+        }};
+
+        while (true == _running.load()) {
+            int timeoutMs = 100;
+            if (true == _gpioPending) {
+                std::int64_t remainingNs = _lastGpioEdgeSentNs + GpioEdgeIntervalNs - TickScheduler::now();
+                timeoutMs = static_cast<int>(std::clamp<std::int64_t>((remainingNs + 999999) / 1000000, 0, timeoutMs));
+            }
+            if (poll(events.data(), events.size(), timeoutMs) > 0) {
+                std::uint64_t value = 0;
+                ssize_t readBytes = 0;
+                if (0 != (events[0].revents & POLLIN)) {
+                    readBytes = read(_event, &value, sizeof(value));
+                }
+                if (0 != (events[1].revents & POLLIN)) {
+                    readBytes = read(events[1].fd, &value, sizeof(value));
+                    _gpioPending = true;
+                }
+                (void)readBytes;
+            }
+            if (true == _gpioPending) {
+                std::int64_t nowNs = TickScheduler::now();
+                if (nowNs - _lastGpioEdgeSentNs >= GpioEdgeIntervalNs) {
+                    _gpioPending = false;
+                    std::uint32_t mask = _gpioSource->getMask();
+                    // A contact that bounced back needs no packet
+                    if (mask != _lastSentGpioMask) {
+                        _lastGpioEdgeSentNs = nowNs;
+                        sendGpio(mask);
+                    }
+                }
+            }
+
+            sendMessages();
+            while (_ring.pop(_batch)) {
+                pack(_batch);
+            }
+        }
+    }
+
+    void sendMessages() {
+        {
+            std::lock_guard<std::mutex> lock(_messagesMutex);
+            _pendingMessages.swap(_messages);
+        }
+
+        for (const auto &message : _pendingMessages) {
+            try {
+                _sink.sendStateMessages({}, {}, message, {});
+            } catch (const std::exception &ex) {
+                _sendFailures.fetch_add(1, std::memory_order_relaxed);
+                printError(ex.what(), _verbose);
+            }
+            if (nullptr != _recorder) {
+                _recorder->append(TickScheduler::now(), {}, false, 0, message);
+            }
+        }
+        _pendingMessages.clear();
+    }
+
+    void sendGpio(std::uint32_t mask) {
+        _lastSentGpioMask = mask;
+        GpioSource::toPinStates(mask, _gpioState);
+        _gpioTimes.gpioEdgeNs = _gpioSource->getLastEdgeTimestamp();
+        try {
+            _sink.sendStateMessages({}, _gpioState, _deviceError, _gpioTimes);
+        } catch (const std::exception &ex) {
+            _sendFailures.fetch_add(1, std::memory_order_relaxed);
+            printError(ex.what(), _verbose);
+        }
+        if (nullptr != _recorder) {
+            _recorder->append(TickScheduler::now(), {}, true, mask, _deviceError);
+        }
+    }
+
+    // Appends the samples of the batch to the packet, which is sent once the
+    // batch that ends it arrives. Every node appears in the packet once per
+    // sample, in sampling order.
+    void pack(const StateBatch &batch) {
+        std::int64_t startNs = TickScheduler::now();
+        if (0 != _packedSamples && _poses.size() + batch.poseCount > MaxPackedPoses) {
+            send();
+        }
+
+        if (0 == _packedSamples) {
+            _poses.clear();
+            _times.sampleTimesNs.clear();
+            _packedTrackingNodeNotFound = false;
+            _packedSetupGpioFailed = false;
+            _packedHasGpio = false;
+        }
+        _poses.insert(_poses.end(), batch.poses.begin(), batch.poses.begin() + batch.poseCount);
+        _times.sampleTimesNs.insert(_times.sampleTimesNs.end(), batch.sampleTimesNs.begin(),
+                                    batch.sampleTimesNs.begin() + batch.poseCount);
+        _packedTrackingNodeNotFound = _packedTrackingNodeNotFound || batch.trackingNodeNotFound;
+        _packedSetupGpioFailed = _packedSetupGpioFailed || batch.setupGpioFailed;
+        if (true == batch.hasGpio) {
+            _packedHasGpio = true;
+            _packedGpioMask = batch.gpioMask;
+            _times.gpioEdgeNs = batch.gpioEdgeNs;
+        }
+        _packedTimestampNs = batch.timestampNs;
+        _packedSamples++;
+
+        if (true == _verbose) {
+            Logger::instance().writeTick(batch, _sink.getCurrentTime());
+        }
+        if (nullptr != _telemetry) {
+            _telemetry->record(Stage::Pack, TickScheduler::now() - startNs);
+        }
+
+        if (true == batch.endsPacket) {
+            send();
+        }
+    }
+
+    void send() {
+        // With delta publishing a packet may end up holding nothing at all
+        if (true == _poses.empty() && false == _packedHasGpio
+                && false == _packedTrackingNodeNotFound && false == _packedSetupGpioFailed) {
+            _packedSamples = 0;
+            return;
+        }
+
+        if (true == _packedHasGpio) {
+            _lastSentGpioMask = _packedGpioMask;
+            GpioSource::toPinStates(_packedGpioMask, _gpioState);
+        } else {
+            _gpioState.clear();
+        }
+
+        _deviceError.clear();
+        if (true == _packedTrackingNodeNotFound) {
+            _deviceError += errorToString(Antilatency::IpNetwork::ErrorType::TrackingNodeNotFound);
+            _deviceError += ' ';
+        }
+        if (true == _packedSetupGpioFailed) {
+            _deviceError += errorToString(Antilatency::IpNetwork::ErrorType::SetupGpio);
+            _deviceError += ' ';
+        }
+
+        std::int64_t startNs = TickScheduler::now();
+        try {
+            _sink.sendStateMessages(_poses, _gpioState, _deviceError, _times);
+            _sentPackets.fetch_add(1, std::memory_order_relaxed);
+            _packedSamplesTotal.fetch_add(_packedSamples, std::memory_order_relaxed);
+        } catch (const std::exception &ex) {
+            _sendFailures.fetch_add(1, std::memory_order_relaxed);
+            printError(ex.what(), _verbose);
+        }
+        if (nullptr != _telemetry) {
+            _telemetry->record(Stage::Send, TickScheduler::now() - startNs);
+        }
+        if (nullptr != _recorder) {
+            _recorder->append(_packedTimestampNs, _poses, _packedHasGpio, _packedGpioMask, _deviceError);
+        }
+        _packedSamples = 0;
+    }
+
+    NetworkSink &_sink;
+    const bool _verbose;
+    const GpioSource *_gpioSource = nullptr;
+    Telemetry *_telemetry = nullptr;
+    RecordWriter *_recorder = nullptr;
+
+    SpscRing<StateBatch> _ring;
+    int _event = -1;
+    std::atomic<bool> _running{false};
+    std::thread _thread{};
+
+    std::mutex _messagesMutex{};
+    std::vector<std::string> _messages{};
+    std::vector<std::string> _pendingMessages{};
+
+    StateBatch _batch{};
+    std::uint32_t _packedSamples = 0;
+    std::int64_t _packedTimestampNs = 0;
+    bool _packedTrackingNodeNotFound = false;
+    bool _packedSetupGpioFailed = false;
+    bool _packedHasGpio = false;
+    std::uint32_t _packedGpioMask = 0;
+    std::vector<Antilatency::IpNetwork::StateMessage> _poses{};
+    // Sample times of _poses
+    PacketTimes _times{};
+    PacketTimes _gpioTimes{};
+    std::vector<Antilatency::IpNetwork::GpioPinState> _gpioState{};
+    bool _gpioPending = false;
+    std::int64_t _lastGpioEdgeSentNs = 0;
+    std::uint32_t _lastSentGpioMask = 0;
+    std::string _deviceError{};
+    std::atomic<std::uint64_t> _sendFailures{0};
+    std::atomic<std::uint64_t> _sentPackets{0};
+    std::atomic<std::uint64_t> _packedSamplesTotal{0};
+};
+
+}
@@ -0,0 +1,324 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "Log.h"
+#include "TickScheduler.h"
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+// Log-linear histogram of durations in nanoseconds: every power of two range
+// is split into 8 equal buckets, so any recorded value is reported within
+// 12.5% of its real value. Every histogram has a single writer; readers may
+// see a slightly stale snapshot.
+class LatencyHistogram {
+public:
+    static constexpr unsigned SubBucketBits = 3;
+    static constexpr std::uint64_t SubBuckets = 1 << SubBucketBits;
+    static constexpr std::size_t BucketCount = (64 - SubBucketBits) * SubBuckets;
+
+    void record(std::int64_t valueNs) {
+        std::uint64_t value = valueNs > 0 ? static_cast<std::uint64_t>(valueNs) : 0;
+        increment(_buckets[indexOf(value)], 1);
+        increment(_count, 1);
+        increment(_sum, value);
+        if (value > _max.load(std::memory_order_relaxed)) {
+            _max.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    std::uint64_t getCount() const {
+        return _count.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t getMax() const {
+        return _max.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t getMean() const {
+        std::uint64_t count = getCount();
+        return 0 == count ? 0 : _sum.load(std::memory_order_relaxed) / count;
+    }
+
+    // Upper bound of the bucket holding the given quantile, 0 <= quantile <= 1
+    std::uint64_t getPercentile(double quantile) const {
+        std::uint64_t count = getCount();
+        if (0 == count) {
+            return 0;
+        }
+
+        std::uint64_t rank = static_cast<std::uint64_t>(quantile * static_cast<double>(count - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (std::size_t index = 0; index < BucketCount; index++) {
+            seen += _buckets[index].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                return std::min(upperBound(index), getMax());
+            }
+        }
+        return getMax();
+    }
+
+    static std::size_t indexOf(std::uint64_t value) {
+        if (value < SubBuckets) {
+            return static_cast<std::size_t>(value);
+        }
+        unsigned shift = 63 - __builtin_clzll(value) - SubBucketBits;
+        std::uint64_t subBucket = (value >> shift) & (SubBuckets - 1);
+        return (shift + 1) * SubBuckets + subBucket;
+    }
+
+    static std::uint64_t upperBound(std::size_t index) {
+        if (index < SubBuckets) {
+            return index;
+        }
+        std::uint64_t shift = index / SubBuckets - 1;
+        std::uint64_t subBucket = index % SubBuckets;
+        return ((SubBuckets + subBucket + 1) << shift) - 1;
+    }
+
+private:
+    static void increment(std::atomic<std::uint64_t> &counter, std::uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<std::uint64_t>, BucketCount> _buckets{};
+    std::atomic<std::uint64_t> _count{0};
+    std::atomic<std::uint64_t> _sum{0};
+    std::atomic<std::uint64_t> _max{0};
+};
+
+enum class Stage {
+    Tick,
+    Lateness,
+    Commands,
+    Gpio,
+    Environment,
+    Reconcile,
+    GetState,
+    Smoothing,
+    Pack,
+    Send,
+    Count
+};
+
+enum class Counter {
+    Ticks,
+    Overruns,
+    SkippedTicks,
+    Restarts,
+    TaskFailures,
+    SendFailures,
+    DroppedBatches,
+    CoalescedBatches,
+    SentPackets,
+    PackedSamples,
+    SuppressedSamples,
+    LogDropped,
+    Count
+};
+
+// Send latency and failures of one receiver of the fan-out
+struct DestinationTelemetry {
+    std::string name{};
+    LatencyHistogram send{};
+    std::atomic<std::uint64_t> sent{0};
+    std::atomic<std::uint64_t> dropped{0};
+};
+
+// Per-stage latency histograms and counters of the provider. A snapshot is
+// periodically written to a file as JSON; the file is replaced atomically, so
+// readers never see a partial snapshot.
+class Telemetry {
+public:
+    class StageTimer {
+    public:
+        StageTimer(Telemetry &telemetry, Stage stage) :
+            _telemetry(telemetry),
+            _stage(stage),
+            _startNs(TickScheduler::now())
+        {}
+
+        ~StageTimer() {
+            _telemetry.record(_stage, TickScheduler::now() - _startNs);
+        }
+
+    private:
+        Telemetry &_telemetry;
+        const Stage _stage;
+        const std::int64_t _startNs;
+    };
+
+    Telemetry(const std::string &filePath, std::int32_t intervalMs) :
+        _filePath(filePath),
+        _intervalMs(intervalMs < 100 ? 100 : intervalMs),
+        _startNs(TickScheduler::now())
+    {}
+
+    Telemetry(const Telemetry &) = delete;
+    Telemetry &operator=(const Telemetry &) = delete;
+
+    ~Telemetry() {
+        stop();
+    }
+
+    void start() {
+        if (true == _filePath.empty() || true == _running) {
+            return;
+        }
+        _running = true;
+        _thread = std::thread(&Telemetry::run, this);
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (false == _running) {
+                return;
+            }
+            _running = false;
+        }
+        _wakeUp.notify_one();
+        _thread.join();
+    }
+
+    void record(Stage stage, std::int64_t durationNs) {
+        _histograms[static_cast<std::size_t>(stage)].record(durationNs);
+    }
+
+    void setCounter(Counter counter, std::uint64_t value) {
+        _counters[static_cast<std::size_t>(counter)].store(value, std::memory_order_relaxed);
+    }
+
+    std::uint64_t getCounter(Counter counter) const {
+        return _counters[static_cast<std::size_t>(counter)].load(std::memory_order_relaxed);
+    }
+
+    const LatencyHistogram &getHistogram(Stage stage) const {
+        return _histograms[static_cast<std::size_t>(stage)];
+    }
+
+    static constexpr std::size_t MaxDestinations = 8;
+
+    // Called at startup only, returns nullptr if there are too many destinations
+    DestinationTelemetry *addDestination(const std::string &name) {
+        if (_destinationCount == MaxDestinations) {
+            return nullptr;
+        }
+        auto &destination = _destinations[_destinationCount++];
+        destination.name = name;
+        return &destination;
+    }
+
+    std::string getSnapshot() const {
+        static const std::array<const char *, static_cast<std::size_t>(Stage::Count)> stageNames{
+            "tick", "lateness", "commands", "gpio", "environment", "reconcile", "get_state", "smoothing", "pack", "send"
+        };
+        static const std::array<const char *, static_cast<std::size_t>(Counter::Count)> counterNames{
+            "ticks", "overruns", "skipped_ticks", "restarts", "task_failures",
+            "send_failures", "dropped_batches", "coalesced_batches", "sent_packets", "packed_samples",
+            "suppressed_samples", "log_dropped"
+        };
+
+        std::stringstream output{};
+        output << "{\n  \"uptime_ms\": " << (TickScheduler::now() - _startNs) / 1000000
+               << ",\n  \"counters\": {";
+        for (std::size_t index = 0; index < counterNames.size(); index++) {
+            output << (0 == index ? "\n" : ",\n")
+                   << "    \"" << counterNames[index] << "\": "
+                   << _counters[index].load(std::memory_order_relaxed);
+        }
+        output << "\n  },\n  \"stages_us\": {";
+        for (std::size_t index = 0; index < stageNames.size(); index++) {
+            const auto &histogram = _histograms[index];
+            output << (0 == index ? "\n" : ",\n")
+                   << "    \"" << stageNames[index] << "\": {"
+                   << "\"count\": " << histogram.getCount()
+                   << ", \"mean\": " << histogram.getMean() / 1000
+                   << ", \"p50\": " << histogram.getPercentile(0.5) / 1000
+                   << ", \"p90\": " << histogram.getPercentile(0.9) / 1000
+                   << ", \"p99\": " << histogram.getPercentile(0.99) / 1000
+                   << ", \"p999\": " << histogram.getPercentile(0.999) / 1000
+                   << ", \"max\": " << histogram.getMax() / 1000
+                   << "}";
+        }
+        output << "\n  },\n  \"destinations_us\": {";
+        for (std::size_t index = 0; index < _destinationCount; index++) {
+            const auto &destination = _destinations[index];
+            output << (0 == index ? "\n" : ",\n")
+                   << "    \"" << destination.name << "\": {"
+                   << "\"sent\": " << destination.sent.load(std::memory_order_relaxed)
+                   << ", \"dropped\": " << destination.dropped.load(std::memory_order_relaxed)
+                   << ", \"p50\": " << destination.send.getPercentile(0.5) / 1000
+                   << ", \"p99\": " << destination.send.getPercentile(0.99) / 1000
+                   << ", \"max\": " << destination.send.getMax() / 1000
+                   << "}";
+        }
+        output << "\n  }\n}\n";
+        return output.str();
+    }
+
+    bool writeSnapshot() {
+        if (true == _filePath.empty()) {
+            return false;
+        }
+
+        setCounter(Counter::LogDropped, Logger::instance().getDropped() + Logger::instance().getSuppressed());
+
+        std::string tmpPath = _filePath + ".tmp";
+        {
+            std::ofstream file(tmpPath, std::ios::trunc);
+            if (false == file.is_open()) {
+                return false;
+            }
+            file << getSnapshot();
+            if (false == file.good()) {
+                return false;
+            }
+        }
+        return 0 == std::rename(tmpPath.c_str(), _filePath.c_str());
+    }
+
+private:
+    void run() {
+        bool failed = false;
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true == _running) {
+            _wakeUp.wait_for(lock, std::chrono::milliseconds(_intervalMs));
+            lock.unlock();
+
+            bool written = writeSnapshot();
+            if (false == written && false == failed) {
+                Logger::instance().write(LogLevel::Error, "Could not write telemetry snapshot to " + _filePath);
+            }
+            failed = false == written;
+
+            lock.lock();
+        }
+    }
+
+    const std::string _filePath;
+    const std::int32_t _intervalMs;
+    const std::int64_t _startNs;
+
+    std::array<LatencyHistogram, static_cast<std::size_t>(Stage::Count)> _histograms{};
+    std::array<std::atomic<std::uint64_t>, static_cast<std::size_t>(Counter::Count)> _counters{};
+    std::array<DestinationTelemetry, MaxDestinations> _destinations{};
+    std::size_t _destinationCount = 0;
+
+    std::mutex _mutex{};
+    std::condition_variable _wakeUp{};
+    bool _running = false;
+    std::thread _thread{};
+};
+
+}
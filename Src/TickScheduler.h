@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <cerrno>
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+enum class OverrunPolicy {
+    // Fire every missed deadline back-to-back until the schedule is caught up
+    CatchUp,
+    // Drop missed deadlines and continue from the next one in the future
+    Skip
+};
+
+struct TickStatistics {
+    std::uint64_t ticks = 0;
+    std::uint64_t overruns = 0;
+    std::uint64_t skippedTicks = 0;
+    std::int64_t lastLatenessNs = 0;
+    std::int64_t maxLatenessNs = 0;
+    std::int64_t totalLatenessNs = 0;
+};
+
+// Runs ticks on absolute CLOCK_MONOTONIC deadlines, so the time spent
+// inside a tick does not stretch the period.
+class TickScheduler {
+public:
+    TickScheduler(std::int32_t periodMs, OverrunPolicy policy) :
+        _policy(policy)
+    {
+        setPeriod(periodMs);
+    }
+
+    // The new period takes effect from the next deadline
+    void setPeriod(std::int32_t periodMs) {
+        if (periodMs < 1) {
+            periodMs = 1;
+        }
+        _periodNs = static_cast<std::int64_t>(periodMs) * 1000000;
+    }
+
+    std::int64_t getPeriodNs() const {
+        return _periodNs;
+    }
+
+    // Sleeps until the next deadline and returns how late the wake-up was, ns
+    std::int64_t waitNextTick() {
+        if (0 == _deadlineNs) {
+            _deadlineNs = now();
+        }
+        _deadlineNs += _periodNs;
+
+        timespec deadline = toTimespec(_deadlineNs);
+        while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr)) {}
+
+        std::int64_t lateness = now() - _deadlineNs;
+
+        _statistics.ticks++;
+        _statistics.lastLatenessNs = lateness;
+        _statistics.totalLatenessNs += lateness;
+        if (lateness > _statistics.maxLatenessNs) {
+            _statistics.maxLatenessNs = lateness;
+        }
+
+        if (lateness >= _periodNs) {
+            _statistics.overruns++;
+            if (OverrunPolicy::Skip == _policy) {
+                std::int64_t missed = lateness / _periodNs;
+                _deadlineNs += missed * _periodNs;
+                _statistics.skippedTicks += missed;
+            }
+        }
+
+        return lateness;
+    }
+
+    const TickStatistics &getStatistics() const {
+        return _statistics;
+    }
+
+    static std::int64_t now() {
+        timespec ts{};
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<std::int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+private:
+    static timespec toTimespec(std::int64_t ns) {
+        timespec ts{};
+        ts.tv_sec = static_cast<time_t>(ns / 1000000000);
+        ts.tv_nsec = static_cast<long>(ns % 1000000000);
+        return ts;
+    }
+
+    OverrunPolicy _policy = OverrunPolicy::Skip;
+    std::int64_t _periodNs = 0;
+    std::int64_t _deadlineNs = 0;
+    TickStatistics _statistics{};
+};
+
+}
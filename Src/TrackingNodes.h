@@ -0,0 +1,151 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Antilatency.Api.h>
+
+#include "AdaptiveSendRate.h"
+#include "Backend.h"
+#include "Parameters.h"
+#include "StateBatch.h"
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+enum class TrackingNodeState {
+    // A task is running but has not produced a sample yet
+    Starting,
+    Tracking,
+    // The task finished or could not be started, a restart is scheduled
+    Failed,
+    // Waiting for the scheduled restart time
+    Backoff
+};
+
+struct TrackingNodeHealth {
+    TrackingNodeState state = TrackingNodeState::Starting;
+    std::uint32_t restarts = 0;
+    std::uint32_t consecutiveFailures = 0;
+    std::int64_t failedAtNs = 0;
+    std::int64_t retryAtNs = 0;
+    std::int64_t trackingSinceNs = 0;
+    std::int64_t lastRecoveryNs = 0;
+};
+
+struct TrackingNode {
+    Antilatency::DeviceNetwork::NodeHandle node = Antilatency::DeviceNetwork::NodeHandle::Null;
+    std::unique_ptr<TrackingTask> trackingCotask{};
+    Antilatency::IpNetwork::RawString32 tag{};
+    std::string tagName{};
+    std::string serialNumber{};
+    TrackingNodeHealth health{};
+    // Switched off by a SetNodeEnabled command: no task runs and nothing is sent
+    bool enabled = true;
+    // Last pose sent to the receiver, for delta publishing
+    Antilatency::IpNetwork::StateMessage published{};
+    bool hasPublished = false;
+    // With --adaptive-rate
+    NodeSendRate sendRate{};
+};
+
+struct ReconcileResult {
+    std::size_t kept = 0;
+    std::size_t added = 0;
+    std::size_t retired = 0;
+    // New nodes past MaxTrackingNodes, not tracked
+    std::size_t dropped = 0;
+};
+
+// Brings the tracking node list in line with the device network without
+// touching the nodes that are still present: running cotasks and cached tags
+// are kept, only new nodes are added and only the nodes that disappeared are
+// retired. A node is identified by its handle together with the serial number
+// of its parent, so a reused handle is not mistaken for the device that held
+// it before. Tasks of the added nodes are started by TrackingSupervisor.
+// Nodes past MaxTrackingNodes are left out until others disappear.
+class TrackingNodeReconciler {
+public:
+    TrackingNodeReconciler(TrackingBackend &backend, NetworkSink &sink, bool verbose) :
+        _backend(backend),
+        _sink(sink),
+        _verbose(verbose)
+    {}
+
+    ReconcileResult reconcile(std::vector<TrackingNode> &trackingNodes) {
+        ReconcileResult result{};
+
+        auto nodes = _backend.findSupportedNodes();
+
+        auto retiredBegin = std::stable_partition(
+            trackingNodes.begin(),
+            trackingNodes.end(),
+            [&](const TrackingNode &trackingNode) {
+                if (0 == std::count(nodes.begin(), nodes.end(), trackingNode.node)) {
+                    return false;
+                }
+                return getSerialNumber(trackingNode.node) == trackingNode.serialNumber;
+            });
+        result.retired = std::distance(retiredBegin, trackingNodes.end());
+        trackingNodes.erase(retiredBegin, trackingNodes.end());
+        result.kept = trackingNodes.size();
+
+        for (auto node : nodes) {
+            if (node == Antilatency::DeviceNetwork::NodeHandle::Null) {
+                continue;
+            }
+            if (_backend.nodeGetStatus(node) != Antilatency::DeviceNetwork::NodeStatus::Idle) {
+                continue;
+            }
+            bool known = std::any_of(
+                trackingNodes.begin(),
+                trackingNodes.end(),
+                [node](const TrackingNode &trackingNode) { return trackingNode.node == node; });
+            if (true == known) {
+                continue;
+            }
+
+            if (trackingNodes.size() >= MaxTrackingNodes) {
+                result.dropped++;
+                continue;
+            }
+
+            TrackingNode trackingNode;
+            trackingNode.node = node;
+            trackingNode.serialNumber = getSerialNumber(node);
+
+            std::string tag = getParentProperty(node, "Tag");
+            if (true == tag.empty()) {
+                tag = trackingNode.serialNumber;
+            }
+            trackingNode.tag = _sink.getRawTagFromString(tag);
+            trackingNode.tagName = tag;
+
+            trackingNodes.push_back(std::move(trackingNode));
+            result.added++;
+        }
+
+        return result;
+    }
+
+private:
+    std::string getSerialNumber(Antilatency::DeviceNetwork::NodeHandle node) {
+        return getParentProperty(node, Antilatency::DeviceNetwork::Interop::Constants::HardwareSerialNumberKey);
+    }
+
+    std::string getParentProperty(Antilatency::DeviceNetwork::NodeHandle node, const std::string &key) {
+        try {
+            return _backend.nodeGetParentProperty(node, key);
+        } catch (const std::exception &ex) {
+            printError(ex.what(), _verbose);
+        }
+        return {};
+    }
+
+    TrackingBackend &_backend;
+    NetworkSink &_sink;
+    const bool _verbose;
+};
+
+}
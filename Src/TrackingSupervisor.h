@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include <Antilatency.Api.h>
+
+#include "Backend.h"
+#include "Parameters.h"
+#include "TrackingNodes.h"
+
+namespace Antilatency::IpTrackingDemoProvider {
+
+enum class SupervisorEvent {
+    None,
+    Started,
+    StartFailed,
+    TaskFinished
+};
+
+struct SupervisorStatistics {
+    std::uint64_t restarts = 0;
+    std::uint64_t failures = 0;
+    std::uint64_t recoveries = 0;
+    std::int64_t lastRecoveryNs = 0;
+    std::int64_t maxRecoveryNs = 0;
+};
+
+// Owns the cotask lifecycle of every tracking node: starts tasks, notices
+// finished ones and restarts them with exponential backoff, so a flaky node
+// is retried at a bounded rate instead of on every tick.
+class TrackingSupervisor {
+public:
+    TrackingSupervisor(TrackingBackend &backend,
+                       std::int32_t backoffMs,
+                       std::int32_t maxBackoffMs,
+                       bool verbose) :
+        _backend(backend),
+        _backoffNs(static_cast<std::int64_t>(std::max(backoffMs, 1)) * 1000000),
+        _maxBackoffNs(static_cast<std::int64_t>(std::max(maxBackoffMs, backoffMs)) * 1000000),
+        _verbose(verbose)
+    {}
+
+    // Advances the node state machine. The node cotask can be sampled
+    // afterwards if it is not nullptr.
+    SupervisorEvent supervise(TrackingNode &trackingNode, std::int64_t nowNs) {
+        auto &health = trackingNode.health;
+
+        if (trackingNode.trackingCotask != nullptr) {
+            if (false == trackingNode.trackingCotask->isTaskFinished()) {
+                return SupervisorEvent::None;
+            }
+            trackingNode.trackingCotask = nullptr;
+            fail(health, nowNs);
+            return SupervisorEvent::TaskFinished;
+        }
+
+        if (nowNs < health.retryAtNs) {
+            health.state = TrackingNodeState::Backoff;
+            return SupervisorEvent::None;
+        }
+
+        try {
+            trackingNode.trackingCotask = _backend.startTask(trackingNode.node);
+        } catch (const std::exception &ex) {
+            printError(ex.what(), _verbose);
+        }
+
+        if (0 != health.failedAtNs) {
+            health.restarts++;
+            _statistics.restarts++;
+        }
+
+        if (trackingNode.trackingCotask == nullptr) {
+            fail(health, nowNs);
+            return SupervisorEvent::StartFailed;
+        }
+
+        health.state = TrackingNodeState::Starting;
+        return SupervisorEvent::Started;
+    }
+
+    // Drops the task of the node, the next supervise() starts a new one in
+    // the current environment right away. The node keeps its health, so this
+    // is not counted as a failure.
+    void rebind(TrackingNode &trackingNode) {
+        trackingNode.trackingCotask = nullptr;
+        trackingNode.health.retryAtNs = 0;
+    }
+
+    // Called after a successful getState, returns true if the node has just
+    // recovered from a failure
+    bool onSampled(TrackingNode &trackingNode, std::int64_t nowNs) {
+        auto &health = trackingNode.health;
+        if (TrackingNodeState::Starting != health.state) {
+            return false;
+        }
+
+        health.state = TrackingNodeState::Tracking;
+        health.trackingSinceNs = nowNs;
+        if (0 == health.failedAtNs) {
+            return false;
+        }
+
+        health.lastRecoveryNs = nowNs - health.failedAtNs;
+        health.failedAtNs = 0;
+
+        _statistics.recoveries++;
+        _statistics.lastRecoveryNs = health.lastRecoveryNs;
+        _statistics.maxRecoveryNs = std::max(_statistics.maxRecoveryNs, health.lastRecoveryNs);
+        return true;
+    }
+
+    const SupervisorStatistics &getStatistics() const {
+        return _statistics;
+    }
+
+private:
+    void fail(TrackingNodeHealth &health, std::int64_t nowNs) {
+        // A node that tracked longer than the longest backoff starts over
+        if (TrackingNodeState::Tracking == health.state
+                && nowNs - health.trackingSinceNs >= _maxBackoffNs) {
+            health.consecutiveFailures = 0;
+        }
+
+        std::int64_t backoff = _backoffNs;
+        for (std::uint32_t index = 0; index < health.consecutiveFailures && backoff < _maxBackoffNs; index++) {
+            backoff *= 2;
+        }
+        backoff = std::min(backoff, _maxBackoffNs);
+
+        health.consecutiveFailures++;
+        if (0 == health.failedAtNs) {
+            health.failedAtNs = nowNs;
+        }
+        health.retryAtNs = nowNs + backoff;
+        health.state = TrackingNodeState::Failed;
+
+        _statistics.failures++;
+    }
+
+    TrackingBackend &_backend;
+    const std::int64_t _backoffNs;
+    const std::int64_t _maxBackoffNs;
+    const bool _verbose;
+    SupervisorStatistics _statistics{};
+};
+
+}